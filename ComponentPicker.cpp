@@ -2,21 +2,610 @@
 
 #include "ComponentPicker.h"
 
+#include "Async/ParallelFor.h"
+#include "Components/ActorComponent.h"
+#include "GameFramework/Actor.h"
+#include "Serialization/CustomVersion.h"
+#include "UObject/CoreNet.h"
+
+DEFINE_LOG_CATEGORY( LogComponentPicker );
+
+// Versions of the FComponentPicker binary format.
+struct FComponentPickerCustomVersion
+{
+    enum Type
+    {
+        // Serialized with the tagged properties of the struct
+        BeforeCustomVersionWasAdded = 0,
+
+        // Serialized natively by FComponentPicker::Serialize
+        NativeSerialization,
+
+        // Owner path and component name are serialized after the weak pointer
+        StableIdentity,
+
+        // -----<new versions can be added above this line>-------------------------------------------------
+        VersionPlusOne,
+        LatestVersion = VersionPlusOne - 1
+    };
+
+    static const FGuid GUID;
+};
+
+const FGuid FComponentPickerCustomVersion::GUID( 0x4ACD24E0, 0x1C394D7F, 0x8F988C6B, 0x8AFB86E6 );
+
+static FCustomVersionRegistration GRegisterComponentPickerCustomVersion( FComponentPickerCustomVersion::GUID,
+                                                                         FComponentPickerCustomVersion::LatestVersion,
+                                                                         TEXT( "ComponentPickerVer" ) );
+
+// How the picked component is sent over the network.
+enum class EComponentPickerNetEncoding : uint8
+{
+    // No component picked
+    None,
+
+    // Object reference, for components whose name is stable for networking
+    Object,
+
+    // Reference to the owner actor followed by the name of the component
+    OwnerName,
+
+    Count
+};
+
+static constexpr uint32 ComponentPickerNetEncodingBits = 2;
+static_assert( static_cast<uint32>( EComponentPickerNetEncoding::Count ) <= ( 1u << ComponentPickerNetEncodingBits ),
+               "EComponentPickerNetEncoding does not fit in ComponentPickerNetEncodingBits" );
+
+// Number of pickers resolved by each task of FComponentPicker::GetComponents.
+static constexpr int32 ComponentPickerBatchChunkSize = 4096;
+
+// Results of ContainsComponentPicker, flushed when classes or structs are reloaded or reinstanced.
+static TMap<TObjectKey<UStruct>, bool> GContainsComponentPicker;
+
+// Walk of ContainsComponentPicker. rOutProvisional is set when the result depends on a struct still being walked (a
+// struct containing itself), such a result is only final for the struct the walk started from.
+static bool ContainsComponentPickerWalk( const UStruct* pStruct,
+                                         TArray<const UStruct*, TInlineAllocator<8>>& rWalkedStructs,
+                                         bool& rOutProvisional )
+{
+    if( const bool* pContains = GContainsComponentPicker.Find( pStruct ) )
+    {
+        return *pContains;
+    }
+
+    if( rWalkedStructs.Contains( pStruct ) )
+    {
+        rOutProvisional = true;
+        return false;
+    }
+
+    rWalkedStructs.Push( pStruct );
+
+    bool bContains = false;
+    bool bProvisional = false;
+
+    for( TFieldIterator<FProperty> It( pStruct ); It && !bContains; ++It )
+    {
+        const FProperty* pProperty = *It;
+
+        if( const FArrayProperty* pArrayProperty = CastField<FArrayProperty>( pProperty ) )
+        {
+            pProperty = pArrayProperty->Inner;
+        }
+
+        if( const FStructProperty* pStructProperty = CastField<FStructProperty>( pProperty ) )
+        {
+            bContains = pStructProperty->Struct->IsChildOf( FComponentPicker::StaticStruct( ) ) ||
+                ContainsComponentPickerWalk( pStructProperty->Struct, rWalkedStructs, bProvisional );
+        }
+    }
+
+    rWalkedStructs.Pop( );
+
+    // A picker found is final, not finding one is only final when no struct of the walk was skipped.
+    if( bContains || !bProvisional || rWalkedStructs.Num( ) == 0 )
+    {
+        GContainsComponentPicker.Add( pStruct, bContains );
+    }
+    else
+    {
+        rOutProvisional = true;
+    }
+
+    return bContains;
+}
+
+// Returns whether the struct (or class) has a FComponentPicker property, directly or nested in structs and arrays.
+static bool ContainsComponentPicker( const UStruct* pStruct )
+{
+    static bool bFlushRegistered = false;
+
+    check( IsInGameThread( ) );
+
+    if( !bFlushRegistered )
+    {
+        bFlushRegistered = true;
+
+        // Hot reload and Live Coding.
+        FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda( []( EReloadCompleteReason eReason )
+        {
+            GContainsComponentPicker.Reset( );
+        } );
+
+        // Reinstanced classes and structs (e.g. after a Blueprint or user defined struct compile).
+        FCoreUObjectDelegates::OnObjectsReplaced.AddLambda( []( const TMap<UObject*, UObject*>& rReplacementMap )
+        {
+            for( const TPair<UObject*, UObject*>& rReplacement : rReplacementMap )
+            {
+                if( Cast<UStruct>( rReplacement.Key ) != nullptr )
+                {
+                    GContainsComponentPicker.Reset( );
+                    break;
+                }
+            }
+        } );
+    }
+
+    TArray<const UStruct*, TInlineAllocator<8>> oWalkedStructs;
+    bool bProvisional = false;
+
+    return ContainsComponentPickerWalk( pStruct, oWalkedStructs, bProvisional );
+}
+
+// Walk the properties of a struct (or object) looking for FComponentPicker values.
+static void ForEachComponentPickerInStruct(
+    const UStruct* pStruct,
+    void* pContainer,
+    const FString& rPathPrefix,
+    FComponentPicker::FComponentPickerVisitor oCallback )
+{
+    if( !ContainsComponentPicker( pStruct ) )
+    {
+        return;
+    }
+
+    auto oVisitValue = [&oCallback]( const FProperty* pProperty,
+                                     const FProperty* pMetaDataProperty,
+                                     void* pValue,
+                                     const FString& rPropertyPath )
+    {
+        if( const FStructProperty* pStructProperty = CastField<FStructProperty>( pProperty ) )
+        {
+            if( pStructProperty->Struct->IsChildOf( FComponentPicker::StaticStruct( ) ) )
+            {
+                oCallback( *static_cast<FComponentPicker*>( pValue ), pMetaDataProperty, rPropertyPath );
+            }
+            else
+            {
+                ForEachComponentPickerInStruct( pStructProperty->Struct,
+                                                pValue,
+                                                rPropertyPath + TEXT( "." ),
+                                                oCallback );
+            }
+        }
+    };
+
+    for( TFieldIterator<FProperty> It( pStruct ); It; ++It )
+    {
+        const FProperty* pProperty = *It;
+
+        for( int32 nArrayIndex = 0; nArrayIndex < pProperty->ArrayDim; ++nArrayIndex )
+        {
+            FString strPropertyPath = rPathPrefix + pProperty->GetName( );
+
+            if( pProperty->ArrayDim > 1 )
+            {
+                strPropertyPath += FString::Printf( TEXT( "[%d]" ), nArrayIndex );
+            }
+
+            void* pValue = pProperty->ContainerPtrToValuePtr<void>( pContainer, nArrayIndex );
+
+            if( const FArrayProperty* pArrayProperty = CastField<FArrayProperty>( pProperty ) )
+            {
+                FScriptArrayHelper oArrayHelper( pArrayProperty, pValue );
+
+                for( int32 nIndex = 0; nIndex < oArrayHelper.Num( ); ++nIndex )
+                {
+                    oVisitValue( pArrayProperty->Inner,
+                                 pArrayProperty,
+                                 oArrayHelper.GetRawPtr( nIndex ),
+                                 FString::Printf( TEXT( "%s[%d]" ), *strPropertyPath, nIndex ) );
+                }
+            }
+            else
+            {
+                oVisitValue( pProperty, pProperty, pValue, strPropertyPath );
+            }
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 FComponentPicker::FComponentPicker( UActorComponent* pComponent )
     : m_pPickedComponent( pComponent )
 {
-    // Empty
+    UpdateStableIdentity( );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 UActorComponent* FComponentPicker::GetComponent( ) const
 {
-    return m_pPickedComponent.IsValid( ) ? m_pPickedComponent.Get( ) : nullptr;
+    // Get( ) already returns null for stale pointers, resolve only once.
+    if( UActorComponent* pPickedComponent = m_pPickedComponent.Get( ) )
+    {
+        return pPickedComponent;
+    }
+
+    // The cached pointer stays valid until the component is unloaded again.
+    UActorComponent* pComponent = ResolveStableIdentity( );
+    m_pPickedComponent = pComponent;
+
+    return pComponent;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPicker::GetComponents( TArrayView<const FComponentPicker> rPickers,
+                                      TArrayView<UActorComponent*> rOutComponents,
+                                      bool bAllowParallel )
+{
+    check( rPickers.Num( ) == rOutComponents.Num( ) );
+
+    const int32 nNumChunks = FMath::DivideAndRoundUp( rPickers.Num( ), ComponentPickerBatchChunkSize );
+
+    // Each chunk walks a contiguous range of pickers and resolves every weak pointer once.
+    ParallelFor(
+        nNumChunks,
+        [&rPickers, &rOutComponents]( int32 nChunk )
+        {
+            const int32 nStart = nChunk * ComponentPickerBatchChunkSize;
+            const int32 nEnd = FMath::Min( nStart + ComponentPickerBatchChunkSize, rPickers.Num( ) );
+
+            for( int32 nIndex = nStart; nIndex < nEnd; ++nIndex )
+            {
+                rOutComponents[nIndex] = rPickers[nIndex].m_pPickedComponent.Get( );
+            }
+        },
+        !bAllowParallel || nNumChunks < 2 );
+
+    // Finding stale components from their stable identity is not thread safe, it is done here.
+    for( int32 nIndex = 0; nIndex < rPickers.Num( ); ++nIndex )
+    {
+        if( rOutComponents[nIndex] == nullptr && !rPickers[nIndex].m_strComponentName.IsNone( ) )
+        {
+            rOutComponents[nIndex] = rPickers[nIndex].GetComponent( );
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool FComponentPicker::operator==( const FComponentPicker& rOther ) const
 {
+    if( !m_strComponentName.IsNone( ) || !rOther.m_strComponentName.IsNone( ) )
+    {
+        return m_strComponentName == rOther.m_strComponentName && m_pOwnerActor == rOther.m_pOwnerActor;
+    }
+
     return m_pPickedComponent == rOther.m_pPickedComponent;
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPicker::HasSameTarget( const FComponentPicker& rOther ) const
+{
+    // Same object index and serial number, the stable identities can only be the same.
+    if( !m_pPickedComponent.IsExplicitlyNull( ) &&
+        m_pPickedComponent.HasSameIndexAndSerialNumber( rOther.m_pPickedComponent ) )
+    {
+        return true;
+    }
+
+    return Identical( &rOther, PPF_None );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FSoftObjectPath FComponentPicker::GetOwnerPath( ) const
+{
+    return m_pOwnerActor.ToSoftObjectPath( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FName FComponentPicker::GetComponentName( ) const
+{
+    return m_strComponentName;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPicker::ForEachInObject( UObject* pObject, FComponentPickerVisitor oCallback )
+{
+    if( pObject )
+    {
+        ForEachComponentPickerInStruct( pObject->GetClass( ), pObject, FString( ), oCallback );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPicker::UpdateStableIdentity( )
+{
+    const UActorComponent* pComponent = m_pPickedComponent.Get( );
+
+    m_pOwnerActor = pComponent ? pComponent->GetOwner( ) : nullptr;
+    m_strComponentName = pComponent ? pComponent->GetFName( ) : NAME_None;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UActorComponent* FComponentPicker::ResolveStableIdentity( ) const
+{
+    if( m_strComponentName.IsNone( ) )
+    {
+        return nullptr;
+    }
+
+    // Never load the owner, it is loaded by streaming or World Partition.
+    const AActor* pOwner = m_pOwnerActor.Get( );
+
+    if( pOwner == nullptr )
+    {
+        return nullptr;
+    }
+
+    AActor* pMutableOwner = const_cast<AActor*>( pOwner );
+
+    if( UActorComponent* pComponent = FindObjectFast<UActorComponent>( pMutableOwner, m_strComponentName ) )
+    {
+        return pComponent;
+    }
+
+    // Components that are not directly outered to their owner.
+    for( UActorComponent* pComponent : pOwner->GetComponents( ) )
+    {
+        if( pComponent && pComponent->GetFName( ) == m_strComponentName )
+        {
+            return pComponent;
+        }
+    }
+
+    return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPicker::Serialize( FArchive& rAr )
+{
+    rAr.UsingCustomVersion( FComponentPickerCustomVersion::GUID );
+
+    // Data saved before the native serialization is loaded through the tagged properties.
+    if( rAr.IsLoading( ) &&
+        rAr.CustomVer( FComponentPickerCustomVersion::GUID ) < FComponentPickerCustomVersion::NativeSerialization )
+    {
+        return false;
+    }
+
+    // Pickers loaded while their component was still being loaded (see PostSerialize) get their identity now.
+    if( rAr.IsSaving( ) && m_strComponentName.IsNone( ) && m_pPickedComponent.IsValid( ) )
+    {
+        UpdateStableIdentity( );
+    }
+
+    rAr << m_pPickedComponent;
+
+    if( rAr.IsSaving( ) ||
+        rAr.CustomVer( FComponentPickerCustomVersion::GUID ) >= FComponentPickerCustomVersion::StableIdentity )
+    {
+        rAr << m_pOwnerActor;
+        rAr << m_strComponentName;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPicker::PostSerialize( const FArchive& rAr )
+{
+    // Data saved before the stable identity existed only has the weak pointer. A component that is still being
+    // loaded has no owner yet, its identity is filled when the picker is saved again.
+    if( rAr.IsLoading( ) && m_strComponentName.IsNone( ) )
+    {
+        const UActorComponent* pComponent = m_pPickedComponent.Get( );
+
+        if( pComponent && !pComponent->HasAnyFlags( RF_NeedLoad | RF_NeedPostLoad ) )
+        {
+            UpdateStableIdentity( );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPicker::Identical( const FComponentPicker* pOther, uint32 unPortFlags ) const
+{
+    if( pOther == nullptr )
+    {
+        return false;
+    }
+
+    // Compare the stable identities, or the weak pointers, without resolving them.
+    if( !m_strComponentName.IsNone( ) || !pOther->m_strComponentName.IsNone( ) )
+    {
+        return m_strComponentName == pOther->m_strComponentName && m_pOwnerActor == pOther->m_pOwnerActor;
+    }
+
+    return m_pPickedComponent.HasSameIndexAndSerialNumber( pOther->m_pPickedComponent );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPicker::ExportTextItem( FString& rValueStr,
+                                       const FComponentPicker& rDefaultValue,
+                                       UObject* pParent,
+                                       int32 nPortFlags,
+                                       UObject* pExportRootScope ) const
+{
+    // The text form is the quoted path name of the component, or None.
+    if( const UActorComponent* pComponent = GetComponent( ) )
+    {
+        rValueStr += TEXT( "\"" );
+        rValueStr += pComponent->GetPathName( );
+        rValueStr += TEXT( "\"" );
+    }
+    else if( !m_strComponentName.IsNone( ) && !m_pOwnerActor.IsNull( ) )
+    {
+        // The owner is unloaded, the path of the component is rebuilt from its stable identity.
+        rValueStr += TEXT( "\"" );
+        rValueStr += m_pOwnerActor.ToString( );
+        rValueStr += TEXT( "." );
+        rValueStr += m_strComponentName.ToString( );
+        rValueStr += TEXT( "\"" );
+    }
+    else
+    {
+        rValueStr += TEXT( "None" );
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPicker::ImportTextItem( const TCHAR*& rBuffer,
+                                       int32 nPortFlags,
+                                       UObject* pParent,
+                                       FOutputDevice* pErrorText )
+{
+    // Text exported with the tagged properties, e.g. "(m_pPickedComponent=...)", is imported by the default path.
+    if( *rBuffer == TEXT( '(' ) )
+    {
+        return false;
+    }
+
+    const TCHAR* pBuffer = rBuffer;
+    FString strPathName;
+
+    if( *pBuffer == TEXT( '"' ) )
+    {
+        ++pBuffer;
+
+        while( *pBuffer && *pBuffer != TEXT( '"' ) )
+        {
+            strPathName.AppendChar( *pBuffer++ );
+        }
+
+        if( *pBuffer != TEXT( '"' ) )
+        {
+            return false;
+        }
+
+        ++pBuffer;
+    }
+    else
+    {
+        while( *pBuffer && !FChar::IsWhitespace( *pBuffer ) && *pBuffer != TEXT( ',' ) && *pBuffer != TEXT( ')' ) )
+        {
+            strPathName.AppendChar( *pBuffer++ );
+        }
+    }
+
+    if( strPathName.IsEmpty( ) )
+    {
+        return false;
+    }
+
+    // Components live in levels, never load a package to resolve them.
+    m_pPickedComponent = strPathName == TEXT( "None" ) ? nullptr : FindObject<UActorComponent>( nullptr, *strPathName );
+    UpdateStableIdentity( );
+
+    // The owner is not loaded, keep the identity so the component is resolved once it is.
+    FString strOwnerPath;
+    FString strComponentName;
+
+    if( !m_pPickedComponent.IsValid( ) &&
+        strPathName != TEXT( "None" ) &&
+        strPathName.Split( TEXT( "." ),
+                           &strOwnerPath,
+                           &strComponentName,
+                           ESearchCase::CaseSensitive,
+                           ESearchDir::FromEnd ) )
+    {
+        m_pOwnerActor = TSoftObjectPtr<AActor>( FSoftObjectPath( strOwnerPath ) );
+        m_strComponentName = *strComponentName;
+    }
+
+    rBuffer = pBuffer;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPicker::NetSerialize( FArchive& rAr, UPackageMap* pMap, bool& bOutSuccess )
+{
+    bOutSuccess = true;
+
+    EComponentPickerNetEncoding eEncoding = EComponentPickerNetEncoding::None;
+    UActorComponent* pComponent = nullptr;
+
+    if( rAr.IsSaving( ) )
+    {
+        pComponent = GetComponent( );
+
+        if( pComponent != nullptr )
+        {
+            // Components with a stable name are referenced by the package map like any other object. The others
+            // (e.g. spawned at runtime) have no network GUID until they replicate, they are found from their owner.
+            eEncoding = pComponent->IsNameStableForNetworking( ) || pComponent->GetOwner( ) == nullptr
+                ? EComponentPickerNetEncoding::Object
+                : EComponentPickerNetEncoding::OwnerName;
+        }
+    }
+
+    uint8 unEncoding = static_cast<uint8>( eEncoding );
+    rAr.SerializeBits( &unEncoding, ComponentPickerNetEncodingBits );
+    eEncoding = static_cast<EComponentPickerNetEncoding>( unEncoding );
+
+    switch( eEncoding )
+    {
+        case EComponentPickerNetEncoding::None:
+        {
+            if( rAr.IsLoading( ) )
+            {
+                m_pPickedComponent.Reset( );
+                UpdateStableIdentity( );
+            }
+
+            break;
+        }
+        case EComponentPickerNetEncoding::Object:
+        {
+            UObject* pObject = pComponent;
+            bOutSuccess &= pMap->SerializeObject( rAr, UActorComponent::StaticClass( ), pObject );
+
+            if( rAr.IsLoading( ) )
+            {
+                m_pPickedComponent = Cast<UActorComponent>( pObject );
+                UpdateStableIdentity( );
+            }
+
+            break;
+        }
+        case EComponentPickerNetEncoding::OwnerName:
+        {
+            UObject* pOwner = pComponent ? pComponent->GetOwner( ) : nullptr;
+            bOutSuccess &= pMap->SerializeObject( rAr, AActor::StaticClass( ), pOwner );
+
+            FName strComponentName = pComponent ? pComponent->GetFName( ) : NAME_None;
+            rAr << strComponentName;
+
+            if( rAr.IsLoading( ) )
+            {
+                // The component is found by name, so a missing component stays null instead of being mistaken for
+                // another one. The identity is kept to resolve it once the owner or the component replicates.
+                m_pOwnerActor = Cast<AActor>( pOwner );
+                m_strComponentName = strComponentName;
+                m_pPickedComponent = ResolveStableIdentity( );
+            }
+
+            break;
+        }
+        default:
+        {
+            bOutSuccess = false;
+            break;
+        }
+    }
+
+    return true;
+}
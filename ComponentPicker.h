@@ -4,8 +4,11 @@
 
 #include "ComponentPicker.generated.h"
 
+class AActor;
 class UActorComponent;
 
+DECLARE_LOG_CATEGORY_EXTERN( LogComponentPicker, Log, All );
+
 // UPROPERTY's that have this type will display a component picker in the editor, allowing users to select a component
 // from an actor in the scene.
 USTRUCT( )
@@ -19,14 +22,119 @@ struct FComponentPicker
     // Construct with default component selected
     FComponentPicker( UActorComponent* pComponent );
 
-    // Get the component that was picked from the scene
+    // Get the component that was picked from the scene. If the component was unloaded (level streaming, World
+    // Partition) it is found again from its owner and name once the owner is loaded.
     UActorComponent* GetComponent( ) const;
 
+    // Get the components of many pickers at once. The weak pointers are resolved in chunks, spread over the task
+    // graph when bAllowParallel is set and the batch is large enough. rOutComponents must be as large as rPickers.
+    static void GetComponents( TArrayView<const FComponentPicker> rPickers,
+                               TArrayView<UActorComponent*> rOutComponents,
+                               bool bAllowParallel = true );
+
     // Comparison operator
     bool operator== ( const FComponentPicker& rOther ) const;
 
+    // Returns whether both pickers target the same component, without resolving the weak pointers.
+    bool HasSameTarget( const FComponentPicker& rOther ) const;
+
+    // Stable identity of the picked component, as stored when it was picked: the path of its owner and its name. It
+    // survives the component being destroyed and created again by a construction script.
+    FSoftObjectPath GetOwnerPath( ) const;
+    FName GetComponentName( ) const;
+
+    // Call oCallback for every FComponentPicker in the reflected properties of the object, including the ones nested
+    // in structs and arrays. The callback receives the property holding the metadata (the array property for array
+    // elements) and the path of the value relative to the object. Classes and structs that can't contain a picker
+    // are skipped without walking their properties.
+    typedef TFunctionRef<void( FComponentPicker& rPicker, const FProperty* pProperty, const FString& rPropertyPath )>
+        FComponentPickerVisitor;
+    static void ForEachInObject( UObject* pObject, FComponentPickerVisitor oCallback );
+
+    // Native struct operations, see TStructOpsTypeTraits<FComponentPicker> below.
+    bool Serialize( FArchive& rAr );
+    bool Identical( const FComponentPicker* pOther, uint32 unPortFlags ) const;
+    bool ExportTextItem( FString& rValueStr,
+                         const FComponentPicker& rDefaultValue,
+                         UObject* pParent,
+                         int32 nPortFlags,
+                         UObject* pExportRootScope ) const;
+    bool ImportTextItem( const TCHAR*& rBuffer, int32 nPortFlags, UObject* pParent, FOutputDevice* pErrorText );
+    bool NetSerialize( FArchive& rAr, class UPackageMap* pMap, bool& bOutSuccess );
+    void PostSerialize( const FArchive& rAr );
+
 private:
-    // The component that has been picked from the scene
+    // Store the owner and name of the picked component.
+    void UpdateStableIdentity( );
+
+    // Find the component from its owner and name, returns null if the owner is not loaded.
+    UActorComponent* ResolveStableIdentity( ) const;
+
+private:
+    // The component that has been picked from the scene, resolved again from the stable identity when it is stale
+    UPROPERTY( )
+    mutable TWeakObjectPtr<UActorComponent> m_pPickedComponent = nullptr;
+
+    // Stable identity of the picked component: the path of its owner and its name. Unlike the weak pointer it
+    // survives the owner being unloaded and loaded again.
+    UPROPERTY( )
+    TSoftObjectPtr<AActor> m_pOwnerActor;
+
     UPROPERTY( )
-    TWeakObjectPtr<UActorComponent> m_pPickedComponent = nullptr;
-};
\ No newline at end of file
+    FName m_strComponentName;
+};
+
+template<>
+struct TStructOpsTypeTraits<FComponentPicker> : public TStructOpsTypeTraitsBase2<FComponentPicker>
+{
+    enum
+    {
+        WithSerializer = true,
+        WithIdentical = true,
+        WithExportTextItem = true,
+        WithImportTextItem = true,
+        WithNetSerializer = true,
+        WithPostSerialize = true,
+    };
+};
+
+// Declares the typed accessors of a struct deriving from FComponentPicker whose components are all of TComponent.
+// Use it after GENERATED_BODY( ) in reflected structs, together with DECLARE_COMPONENT_PICKER_STRUCT_OPS.
+#define COMPONENT_PICKER_BODY( StructType, TComponent )                                                            \
+public:                                                                                                            \
+    typedef TComponent FComponentType;                                                                             \
+                                                                                                                   \
+    StructType( ) = default;                                                                                       \
+                                                                                                                   \
+    StructType( TComponent* pComponent )                                                                           \
+        : FComponentPicker( pComponent )                                                                           \
+    {                                                                                                              \
+    }                                                                                                              \
+                                                                                                                   \
+    /* Text import, redirects and assignments through FComponentPicker don't know TComponent, so another class   \
+       can end up picked. It reads as null instead of a bad static_cast in shipping builds. */                     \
+    TComponent* Get( ) const                                                                                       \
+    {                                                                                                              \
+        return Cast<TComponent>( GetComponent( ) );                                                                \
+    }
+
+// Shares the serialization and the other struct operations of FComponentPicker with a reflected struct deriving from
+// it. Must be used at global scope, after the struct declaration.
+#define DECLARE_COMPONENT_PICKER_STRUCT_OPS( StructType )                                                          \
+    static_assert( sizeof( StructType ) == sizeof( FComponentPicker ),                                             \
+                   #StructType " must not add members to FComponentPicker" );                                      \
+    template<>                                                                                                     \
+    struct TStructOpsTypeTraits<StructType> : public TStructOpsTypeTraits<FComponentPicker>                        \
+    {                                                                                                              \
+    };
+
+// Typed variant of FComponentPicker for native code, e.g. TComponentPicker<UPrimitiveComponent>. UHT does not
+// support templates, reflected properties use a struct declared with COMPONENT_PICKER_BODY instead.
+template<typename TComponent>
+struct TComponentPicker : public FComponentPicker
+{
+    static_assert( TIsDerivedFrom<TComponent, UActorComponent>::IsDerived,
+                   "TComponentPicker can only pick actor components" );
+
+    COMPONENT_PICKER_BODY( TComponentPicker, TComponent )
+};
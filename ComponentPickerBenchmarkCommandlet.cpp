@@ -0,0 +1,1047 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerBenchmarkCommandlet.h"
+#include "ComponentPicker.h"
+#include "ComponentPickerCustomization.h"
+#include "ComponentPickerIndex.h"
+#include "ComponentPickerIndexCache.h"
+#include "ComponentPickerSearchIndex.h"
+#include "SComponentPicker.h"
+
+#include "Components/SceneComponent.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/CustomVersion.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/UObjectIterator.h"
+
+namespace ComponentPickerBenchmark
+{
+    // Timings of one benchmark for one world size.
+    struct FResult
+    {
+        FString strName;
+        int32 nNumActors = 0;
+        int32 nNumComponentsPerActor = 0;
+        int32 nNumItems = 0;
+        int64 nNumBits = 0;
+        double fMinMs = 0.0;
+        double fMedianMs = 0.0;
+        double fMeanMs = 0.0;
+    };
+
+    // Number of classes in the filter lists of the class filter benchmarks.
+    static const int32 FilterListSizes[] = { 1, 8, 64 };
+
+    // Number of loaded interfaces whose AllowedClasses filters are compared with their expansion.
+    static const int32 InterfaceFilterChecks = 32;
+
+    // Number of results asked from the search index, as the picker does.
+    static const int32 SearchMaxResults = 2000;
+
+    // Number of result checks that failed, the commandlet fails when it is not zero.
+    static int32 GNumFailedChecks = 0;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void Verify( bool bCondition, const FString& rName )
+    {
+        if( !bCondition )
+        {
+            UE_LOG( LogComponentPicker, Error, TEXT( "Check failed: %s" ), *rName );
+            ++GNumFailedChecks;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static bool IsFilteredClassLinear( const UClass* pClass,
+                                       const TArray<const UClass*>& rAllowedClasses,
+                                       const TArray<const UClass*>& rDisallowedClasses )
+    {
+        // The walk of the filter lists done for every visited object before the filters were compiled.
+        bool bAllowed = rAllowedClasses.Num( ) == 0;
+
+        for( const UClass* pAllowedClass : rAllowedClasses )
+        {
+            if( pClass->IsChildOf( pAllowedClass ) ||
+                ( pAllowedClass->HasAnyClassFlags( CLASS_Interface ) && pClass->ImplementsInterface( pAllowedClass ) ) )
+            {
+                bAllowed = true;
+                break;
+            }
+        }
+
+        for( const UClass* pDisallowedClass : rDisallowedClasses )
+        {
+            if( !bAllowed )
+            {
+                break;
+            }
+
+            if( pClass->IsChildOf( pDisallowedClass ) ||
+                ( pDisallowedClass->HasAnyClassFlags( CLASS_Interface ) &&
+                  pClass->ImplementsInterface( pDisallowedClass ) ) )
+            {
+                bAllowed = false;
+            }
+        }
+
+        return bAllowed;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void ExpandInterfaceLinear( const UClass* pInterface,
+                                       bool bAllowAnyActor,
+                                       TArray<const UClass*>& rOutActorClasses,
+                                       TArray<const UClass*>& rOutComponentClasses )
+    {
+        // The metadata parsing done before the filters were compiled: an interface was replaced by the loaded classes
+        // implementing it, sorted in the actor and component lists.
+        for( TObjectIterator<UClass> It; It; ++It )
+        {
+            if( !It->ImplementsInterface( pInterface ) )
+            {
+                continue;
+            }
+
+            if( bAllowAnyActor && It->IsChildOf( AActor::StaticClass( ) ) )
+            {
+                rOutActorClasses.Add( *It );
+            }
+            else if( It->IsChildOf( UActorComponent::StaticClass( ) ) )
+            {
+                rOutComponentClasses.Add( *It );
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void Measure( const FString& rName,
+                         int32 nNumActors,
+                         int32 nNumComponentsPerActor,
+                         int32 nNumItems,
+                         int32 nNumIterations,
+                         TFunctionRef<void( )> oBody,
+                         TArray<FResult>& rOutResults )
+    {
+        TArray<double> oTimes;
+        oTimes.Reserve( nNumIterations );
+
+        for( int32 nIteration = 0; nIteration < nNumIterations; ++nIteration )
+        {
+            const double fStartTime = FPlatformTime::Seconds( );
+            oBody( );
+            oTimes.Add( ( FPlatformTime::Seconds( ) - fStartTime ) * 1000.0 );
+        }
+
+        oTimes.Sort( );
+
+        FResult& rResult = rOutResults.AddDefaulted_GetRef( );
+        rResult.strName = rName;
+        rResult.nNumActors = nNumActors;
+        rResult.nNumComponentsPerActor = nNumComponentsPerActor;
+        rResult.nNumItems = nNumItems;
+        rResult.fMinMs = oTimes[0];
+        rResult.fMedianMs = oTimes[oTimes.Num( ) / 2];
+
+        for( double fTime : oTimes )
+        {
+            rResult.fMeanMs += fTime / oTimes.Num( );
+        }
+
+        UE_LOG( LogComponentPicker, Display, TEXT( "%-32s %6d x %-4d min %9.3f ms  median %9.3f ms  mean %9.3f ms" ),
+                *rName, nNumActors, nNumComponentsPerActor, rResult.fMinMs, rResult.fMedianMs, rResult.fMeanMs );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static UWorld* CreateSyntheticWorld( int32 nNumActors,
+                                         int32 nNumComponentsPerActor,
+                                         TArray<UActorComponent*>& rOutComponents )
+    {
+        UWorld* pWorld = UWorld::CreateWorld( EWorldType::Editor, false, TEXT( "ComponentPickerBenchmark" ) );
+        pWorld->AddToRoot( );
+
+        for( int32 nActor = 0; nActor < nNumActors; ++nActor )
+        {
+            AActor* pActor = pWorld->SpawnActor<AActor>( );
+
+            for( int32 nComponent = 0; nComponent < nNumComponentsPerActor; ++nComponent )
+            {
+                // Instance components can be edited, and picked, on the actor.
+                USceneComponent* pComponent =
+                    NewObject<USceneComponent>( pActor, *FString::Printf( TEXT( "Component%d" ), nComponent ) );
+                pActor->AddInstanceComponent( pComponent );
+
+                if( pActor->GetRootComponent( ) == nullptr )
+                {
+                    pActor->SetRootComponent( pComponent );
+                }
+
+                rOutComponents.Add( pComponent );
+            }
+        }
+
+        return pWorld;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void RunBenchmarks( int32 nNumActors,
+                               int32 nNumComponentsPerActor,
+                               int32 nNumIterations,
+                               TArray<FResult>& rOutResults )
+    {
+        TArray<UActorComponent*> oComponents;
+        UWorld* pWorld = CreateSyntheticWorld( nNumActors, nNumComponentsPerActor, oComponents );
+        ULevel* pLevel = pWorld->PersistentLevel;
+        AActor* pFirstActor = oComponents.Num( ) > 0 ? oComponents[0]->GetOwner( ) : nullptr;
+        const int32 nNumComponents = oComponents.Num( );
+
+        auto oMeasure = [&]( const FString& rName, int32 nNumItems, TFunctionRef<void( )> oBody )
+        {
+            Measure( rName, nNumActors, nNumComponentsPerActor, nNumItems, nNumIterations, oBody, rOutResults );
+        };
+
+        // Component index, cold and warm.
+        TArray<UActorComponent*> oIndexedComponents;
+
+        oMeasure( TEXT( "IndexBuild" ), nNumComponents, [&]( )
+        {
+            FComponentPickerIndex::Get( ).Reset( );
+            oIndexedComponents.Reset( );
+            FComponentPickerIndex::Get( ).GetComponents( pLevel, oIndexedComponents );
+        } );
+
+        oMeasure( TEXT( "IndexQuery" ), nNumComponents, [&]( )
+        {
+            oIndexedComponents.Reset( );
+            FComponentPickerIndex::Get( ).GetComponents( pLevel, oIndexedComponents );
+        } );
+
+        // The index lists the actors in map order, only the set of components is compared.
+        auto oIsIndexComplete = [&]( )
+        {
+            const TSet<UActorComponent*> oIndexedSet( oIndexedComponents );
+            return oIndexedComponents.Num( ) == nNumComponents && oIndexedSet.Num( ) == nNumComponents &&
+                oIndexedSet.Includes( TSet<UActorComponent*>( oComponents ) );
+        };
+
+        Verify( oIsIndexComplete( ), TEXT( "IndexBuild" ) );
+
+        // Component index read from the cache file of the level, against the build from the level actors above.
+        const FString strCacheFilePath = FPaths::ProjectSavedDir( ) / TEXT( "ComponentPicker/Benchmark.cpix" );
+        TSharedPtr<const FComponentPickerIndexCache> pIndexCache;
+
+        oMeasure( TEXT( "IndexCacheWrite" ), nNumComponents, [&]( )
+        {
+            FComponentPickerIndexCache::WriteFile( pLevel, strCacheFilePath );
+        } );
+
+        oMeasure( TEXT( "IndexCacheOpen" ), nNumComponents, [&]( )
+        {
+            pIndexCache = FComponentPickerIndexCache::OpenFile( pLevel, strCacheFilePath );
+        } );
+
+        Verify( pIndexCache.IsValid( ), TEXT( "IndexCacheOpen" ) );
+
+        if( pIndexCache.IsValid( ) )
+        {
+            oMeasure( TEXT( "IndexBuildFromCache" ), nNumComponents, [&]( )
+            {
+                FComponentPickerIndex::Get( ).BuildLevel( pLevel, *pIndexCache );
+                oIndexedComponents.Reset( );
+                FComponentPickerIndex::Get( ).GetComponents( pLevel, oIndexedComponents );
+            } );
+
+            Verify( oIsIndexComplete( ), TEXT( "IndexBuildFromCache" ) );
+        }
+
+        pIndexCache.Reset( );
+        IFileManager::Get( ).Delete( *strCacheFilePath );
+
+        // Picker open latency, only the first slice of the list is populated synchronously.
+        if( FSlateApplication::IsInitialized( ) )
+        {
+            oMeasure( TEXT( "OpenPicker" ), nNumComponents, [&]( )
+            {
+                TSharedRef<SComponentPicker> pPicker = SNew( SComponentPicker )
+                    .pOwnerActor( pFirstActor )
+                    .bAllowAnyActor( true );
+            } );
+        }
+
+        // The rules evaluated by the picker filters for every candidate.
+        const TSharedRef<const FComponentPickerClassFilters> pNoFilters =
+            FComponentPickerClassFilterCache::Get( ).FindOrBuild( FString( ), FString( ), true );
+
+        oMeasure( TEXT( "ValidateComponent" ), nNumComponents, [&]( )
+        {
+            for( const UActorComponent* pComponent : oComponents )
+            {
+                FComponentPickerCustomization::ValidateComponent( pComponent, pFirstActor, true, *pNoFilters );
+            }
+        } );
+
+        // Class filters with growing lists. The first check of a class walks the lists, the next ones are lookups.
+        TArray<const UClass*> oComponentClasses;
+
+        for( TObjectIterator<UClass> It; It; ++It )
+        {
+            if( It->IsChildOf( UActorComponent::StaticClass( ) ) && *It != USceneComponent::StaticClass( ) )
+            {
+                oComponentClasses.Add( *It );
+            }
+        }
+
+        for( int32 nFilterListSize : FilterListSizes )
+        {
+            TArray<const UClass*> oAllowedClasses;
+            TArray<const UClass*> oDisallowedClasses;
+
+            for( int32 nClass = 0; nClass < FMath::Min( nFilterListSize, oComponentClasses.Num( ) ); ++nClass )
+            {
+                oAllowedClasses.Add( oComponentClasses[nClass] );
+            }
+
+            // Every component of the world is a scene component, disallowing another class exercises both lists.
+            oAllowedClasses.Add( USceneComponent::StaticClass( ) );
+            oDisallowedClasses.Add( oComponentClasses.Num( ) > 0 ? oComponentClasses.Last( )
+                                                                 : UActorComponent::StaticClass( ) );
+
+            oMeasure( FString::Printf( TEXT( "ClassFilterLinear_%d" ), nFilterListSize ), nNumComponents, [&]( )
+            {
+                for( const UActorComponent* pComponent : oComponents )
+                {
+                    IsFilteredClassLinear( pComponent->GetClass( ), oAllowedClasses, oDisallowedClasses );
+                }
+            } );
+
+            oMeasure( FString::Printf( TEXT( "ClassFilterCold_%d" ), nFilterListSize ), oComponentClasses.Num( ), [&]( )
+            {
+                const FComponentPickerClassFilter oFilter( oAllowedClasses, oDisallowedClasses );
+
+                for( const UClass* pClass : oComponentClasses )
+                {
+                    oFilter.IsFilteredClass( pClass );
+                }
+            } );
+
+            const FComponentPickerClassFilter oWarmFilter( oAllowedClasses, oDisallowedClasses );
+
+            oMeasure( FString::Printf( TEXT( "ClassFilterWarm_%d" ), nFilterListSize ), nNumComponents, [&]( )
+            {
+                for( const UActorComponent* pComponent : oComponents )
+                {
+                    oWarmFilter.IsFilteredClass( pComponent->GetClass( ) );
+                }
+            } );
+
+            // The compiled filter must give the verdicts of the linear walk.
+            bool bSameVerdicts = true;
+
+            for( const UClass* pClass : oComponentClasses )
+            {
+                bSameVerdicts &= oWarmFilter.IsFilteredClass( pClass ) ==
+                                 IsFilteredClassLinear( pClass, oAllowedClasses, oDisallowedClasses );
+            }
+
+            Verify( bSameVerdicts, FString::Printf( TEXT( "ClassFilter_%d" ), nFilterListSize ) );
+        }
+
+        // Interfaces in AllowedClasses are kept unexpanded, they must still give the verdicts of their expansion to
+        // the implementing classes, whether actors, components or both implement them.
+        {
+            TArray<const UClass*> oInterfaces;
+            TArray<const UClass*> oActorClasses;
+
+            for( TObjectIterator<UClass> It; It; ++It )
+            {
+                if( It->HasAnyClassFlags( CLASS_Interface ) && *It != UInterface::StaticClass( ) )
+                {
+                    oInterfaces.Add( *It );
+                }
+                else if( It->IsChildOf( AActor::StaticClass( ) ) )
+                {
+                    oActorClasses.Add( *It );
+                }
+            }
+
+            const TArray<const UClass*> oNoClasses;
+            int32 nNumCheckedInterfaces = 0;
+            bool bSameVerdicts = true;
+
+            for( const UClass* pInterface : oInterfaces )
+            {
+                TArray<const UClass*> oExpandedActorClasses;
+                TArray<const UClass*> oExpandedComponentClasses;
+                ExpandInterfaceLinear( pInterface, true, oExpandedActorClasses, oExpandedComponentClasses );
+
+                if( oExpandedActorClasses.Num( ) == 0 && oExpandedComponentClasses.Num( ) == 0 )
+                {
+                    continue;
+                }
+
+                const TSharedRef<const FComponentPickerClassFilters> pFilters = FComponentPickerClassFilterCache::Get( )
+                    .FindOrBuild( pInterface->GetPathName( ), FString( ), true );
+
+                for( const UClass* pClass : oActorClasses )
+                {
+                    bSameVerdicts &= pFilters->oActorFilter.IsFilteredClass( pClass ) ==
+                                     IsFilteredClassLinear( pClass, oExpandedActorClasses, oNoClasses );
+                }
+
+                for( const UClass* pClass : oComponentClasses )
+                {
+                    bSameVerdicts &= pFilters->oComponentFilter.IsFilteredClass( pClass ) ==
+                                     IsFilteredClassLinear( pClass, oExpandedComponentClasses, oNoClasses );
+                }
+
+                if( ++nNumCheckedInterfaces == InterfaceFilterChecks )
+                {
+                    break;
+                }
+            }
+
+            Verify( bSameVerdicts, TEXT( "ClassFilterInterface" ) );
+        }
+
+        // Multi-selection: every selected object holds a picker, GetValue compares them and SetValue writes them.
+        TArray<FComponentPicker> oPickers;
+        oPickers.Reserve( nNumComponents );
+
+        for( UActorComponent* pComponent : oComponents )
+        {
+            oPickers.Emplace( pComponent );
+        }
+
+        const FComponentPicker oFirstPicker( pFirstActor ? oComponents[0] : nullptr );
+        TArray<FComponentPicker> oSelection;
+        oSelection.Init( oFirstPicker, nNumComponents );
+
+        TArray<void*> oSelectionRawData;
+        oSelectionRawData.Reserve( nNumComponents );
+
+        for( FComponentPicker& rPicker : oSelection )
+        {
+            oSelectionRawData.Add( &rPicker );
+        }
+
+        // GetValue compares the edited values without resolving them, it used to resolve every one of them.
+        FPropertyAccess::Result eAccess = FPropertyAccess::Fail;
+
+        oMeasure( TEXT( "GetValueMultiSelectResolve" ), nNumComponents, [&]( )
+        {
+            const UActorComponent* pFirstComponent = oSelection[0].GetComponent( );
+            eAccess = FPropertyAccess::Success;
+
+            for( const FComponentPicker& rPicker : oSelection )
+            {
+                if( rPicker.GetComponent( ) != pFirstComponent )
+                {
+                    eAccess = FPropertyAccess::MultipleValues;
+                    break;
+                }
+            }
+        } );
+
+        Verify( eAccess == FPropertyAccess::Success, TEXT( "GetValueMultiSelectResolve" ) );
+
+        oMeasure( TEXT( "GetValueMultiSelect" ), nNumComponents, [&]( )
+        {
+            FComponentPicker oValue;
+            eAccess = FComponentPickerCustomization::ReadRawValues( oSelectionRawData, oValue );
+        } );
+
+        Verify( eAccess == FPropertyAccess::Success, TEXT( "GetValueMultiSelect" ) );
+
+        if( nNumComponents > 1 )
+        {
+            FComponentPicker oValue;
+            oSelection.Last( ) = FComponentPicker( oComponents.Last( ) );
+            Verify( FComponentPickerCustomization::ReadRawValues( oSelectionRawData, oValue ) ==
+                        FPropertyAccess::MultipleValues,
+                    TEXT( "GetValueMultiSelectDifferent" ) );
+            oSelection.Last( ) = oFirstPicker;
+        }
+
+        // SetValue writes the raw data of the edited objects, it used to export the value to text once and parse it
+        // back for every object (SetValueFromFormattedString).
+
+        auto oResetSelection = [&]( )
+        {
+            for( FComponentPicker& rPicker : oSelection )
+            {
+                rPicker = FComponentPicker( );
+            }
+        };
+
+        auto oIsSelectionSet = [&]( )
+        {
+            return oSelection.FindByPredicate( [&oFirstPicker]( const FComponentPicker& rPicker )
+            {
+                return !( rPicker == oFirstPicker );
+            } ) == nullptr;
+        };
+
+        UScriptStruct* pPickerStruct = FComponentPicker::StaticStruct( );
+
+        oResetSelection( );
+        oMeasure( TEXT( "SetValueMultiSelectText" ), nNumComponents, [&]( )
+        {
+            FString strValue;
+            pPickerStruct->ExportText( strValue, &oFirstPicker, nullptr, nullptr, PPF_None, nullptr );
+
+            for( void* pRawPtr : oSelectionRawData )
+            {
+                pPickerStruct->ImportText( *strValue, pRawPtr, nullptr, PPF_None, GWarn, pPickerStruct->GetName( ) );
+            }
+        } );
+
+        Verify( oIsSelectionSet( ), TEXT( "SetValueMultiSelectText" ) );
+
+        oResetSelection( );
+        oMeasure( TEXT( "SetValueMultiSelect" ), nNumComponents, [&]( )
+        {
+            FComponentPickerCustomization::WriteRawValues( oSelectionRawData, oFirstPicker );
+        } );
+
+        Verify( oIsSelectionSet( ), TEXT( "SetValueMultiSelect" ) );
+
+        // Serialization, binary and text. The native struct ops are compared with the reflected property walk they
+        // replaced, and every format must give the saved values back.
+        TArray<FComponentPicker> oLoadedPickers;
+        oLoadedPickers.SetNum( nNumComponents );
+
+        auto oIsRoundTrip = [&]( )
+        {
+            for( int32 nPicker = 0; nPicker < nNumComponents; ++nPicker )
+            {
+                if( !( oLoadedPickers[nPicker] == oPickers[nPicker] ) ||
+                    !oLoadedPickers[nPicker].Identical( &oPickers[nPicker], PPF_None ) ||
+                    oLoadedPickers[nPicker].GetComponent( ) != oPickers[nPicker].GetComponent( ) )
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        auto oResetLoadedPickers = [&]( )
+        {
+            for( FComponentPicker& rPicker : oLoadedPickers )
+            {
+                rPicker = FComponentPicker( );
+            }
+        };
+
+        TArray<uint8> oBytes;
+        FCustomVersionContainer oCustomVersions;
+
+        oMeasure( TEXT( "SerializeReflected" ), nNumComponents, [&]( )
+        {
+            oBytes.Reset( );
+            FMemoryWriter oWriter( oBytes );
+            FObjectAndNameAsStringProxyArchive oArchive( oWriter, false );
+
+            for( FComponentPicker& rPicker : oPickers )
+            {
+                pPickerStruct->SerializeBin( oArchive, &rPicker );
+            }
+        } );
+
+        oResetLoadedPickers( );
+        oMeasure( TEXT( "DeserializeReflected" ), nNumComponents, [&]( )
+        {
+            FMemoryReader oReader( oBytes );
+            FObjectAndNameAsStringProxyArchive oArchive( oReader, true );
+
+            for( FComponentPicker& rPicker : oLoadedPickers )
+            {
+                pPickerStruct->SerializeBin( oArchive, &rPicker );
+            }
+        } );
+
+        Verify( oIsRoundTrip( ), TEXT( "SerializeReflected" ) );
+
+        oMeasure( TEXT( "Serialize" ), nNumComponents, [&]( )
+        {
+            oBytes.Reset( );
+            FMemoryWriter oWriter( oBytes );
+            FObjectAndNameAsStringProxyArchive oArchive( oWriter, false );
+
+            for( FComponentPicker& rPicker : oPickers )
+            {
+                rPicker.Serialize( oArchive );
+            }
+
+            oCustomVersions = oArchive.GetCustomVersions( );
+        } );
+
+        oResetLoadedPickers( );
+        oMeasure( TEXT( "Deserialize" ), nNumComponents, [&]( )
+        {
+            FMemoryReader oReader( oBytes );
+            FObjectAndNameAsStringProxyArchive oArchive( oReader, true );
+            oArchive.SetCustomVersions( oCustomVersions );
+
+            for( FComponentPicker& rPicker : oLoadedPickers )
+            {
+                rPicker.Serialize( oArchive );
+            }
+        } );
+
+        Verify( oIsRoundTrip( ), TEXT( "Serialize" ) );
+
+        TArray<FString> oTexts;
+        oTexts.SetNum( nNumComponents );
+
+        oMeasure( TEXT( "ExportText" ), nNumComponents, [&]( )
+        {
+            for( int32 nPicker = 0; nPicker < nNumComponents; ++nPicker )
+            {
+                oTexts[nPicker].Reset( );
+                oPickers[nPicker].ExportTextItem( oTexts[nPicker], FComponentPicker( ), nullptr, PPF_None, nullptr );
+            }
+        } );
+
+        oResetLoadedPickers( );
+        oMeasure( TEXT( "ImportText" ), nNumComponents, [&]( )
+        {
+            for( int32 nPicker = 0; nPicker < nNumComponents; ++nPicker )
+            {
+                const TCHAR* pBuffer = *oTexts[nPicker];
+                oLoadedPickers[nPicker].ImportTextItem( pBuffer, PPF_None, nullptr, GWarn );
+            }
+        } );
+
+        Verify( oIsRoundTrip( ), TEXT( "ExportText" ) );
+
+        // Delta comparison, as done by the transactions.
+        bool bAllIdentical = true;
+
+        oMeasure( TEXT( "Identical" ), nNumComponents, [&]( )
+        {
+            for( int32 nPicker = 0; nPicker < nNumComponents; ++nPicker )
+            {
+                bAllIdentical &= pPickerStruct->CompareScriptStruct( &oPickers[nPicker], &oLoadedPickers[nPicker], 0 );
+            }
+        } );
+
+        Verify( bAllIdentical, TEXT( "Identical" ) );
+
+        // Component resolution, the GetComponent loop the batch resolver replaces and the batches, which must resolve
+        // the same components.
+        TArray<UActorComponent*> oResolvedComponents;
+        oResolvedComponents.SetNumZeroed( nNumComponents );
+
+        oMeasure( TEXT( "GetComponent" ), nNumComponents, [&]( )
+        {
+            for( int32 nPicker = 0; nPicker < nNumComponents; ++nPicker )
+            {
+                oResolvedComponents[nPicker] = oPickers[nPicker].GetComponent( );
+            }
+        } );
+
+        Verify( oResolvedComponents == oComponents, TEXT( "GetComponent" ) );
+
+        oResolvedComponents.Init( nullptr, nNumComponents );
+        oMeasure( TEXT( "GetComponentsBatch" ), nNumComponents, [&]( )
+        {
+            FComponentPicker::GetComponents( oPickers, oResolvedComponents );
+        } );
+
+        Verify( oResolvedComponents == oComponents, TEXT( "GetComponentsBatch" ) );
+
+        oResolvedComponents.Init( nullptr, nNumComponents );
+        oMeasure( TEXT( "GetComponentsBatchSerial" ), nNumComponents, [&]( )
+        {
+            FComponentPicker::GetComponents( oPickers, oResolvedComponents, false );
+        } );
+
+        Verify( oResolvedComponents == oComponents, TEXT( "GetComponentsBatchSerial" ) );
+
+        // Network size: the struct against the weak pointer sent with SerializeObject before NetSerialize existed.
+        UComponentPickerBenchmarkPackageMap* pPackageMap = NewObject<UComponentPickerBenchmarkPackageMap>( );
+        FNetBitWriter oNetWriter( pPackageMap, 0 );
+
+        oMeasure( TEXT( "NetSerializeObject" ), nNumComponents, [&]( )
+        {
+            oNetWriter.Reset( );
+
+            for( UActorComponent* pComponent : oComponents )
+            {
+                UObject* pObject = pComponent;
+                pPackageMap->SerializeObject( oNetWriter, UActorComponent::StaticClass( ), pObject );
+            }
+        } );
+
+        rOutResults.Last( ).nNumBits = oNetWriter.GetNumBits( );
+
+        oMeasure( TEXT( "NetSerialize" ), nNumComponents, [&]( )
+        {
+            oNetWriter.Reset( );
+
+            for( FComponentPicker& rPicker : oPickers )
+            {
+                bool bSuccess = false;
+                rPicker.NetSerialize( oNetWriter, pPackageMap, bSuccess );
+            }
+        } );
+
+        rOutResults.Last( ).nNumBits = oNetWriter.GetNumBits( );
+
+        oResetLoadedPickers( );
+        oMeasure( TEXT( "NetDeserialize" ), nNumComponents, [&]( )
+        {
+            FNetBitReader oNetReader( pPackageMap, oNetWriter.GetData( ), oNetWriter.GetNumBits( ) );
+
+            for( FComponentPicker& rPicker : oLoadedPickers )
+            {
+                bool bSuccess = false;
+                rPicker.NetSerialize( oNetReader, pPackageMap, bSuccess );
+            }
+        } );
+
+        Verify( oIsRoundTrip( ), TEXT( "NetSerialize" ) );
+
+        FComponentPickerIndex::Get( ).Reset( );
+        pWorld->RemoveFromRoot( );
+        pWorld->DestroyWorld( false );
+        CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void CreateSyntheticClasses( int32 nNumClasses, TArray<UClass*>& rOutClasses )
+    {
+        // Only the hierarchy is read by the class filters, the classes are never instanced. Each class has eight
+        // subclasses, below the two loaded component classes at the root.
+        const UClass* const RootClasses[] = { UActorComponent::StaticClass( ), USceneComponent::StaticClass( ) };
+        rOutClasses.Reserve( nNumClasses );
+
+        for( int32 nClass = 0; nClass < nNumClasses; ++nClass )
+        {
+            const UClass* pSuperClass = nClass < 8 ? RootClasses[nClass % 2] : rOutClasses[nClass / 8 - 1];
+            const FName strName =
+                MakeUniqueObjectName( GetTransientPackage( ), UClass::StaticClass( ), TEXT( "ComponentPickerClass" ) );
+
+            UClass* pClass = NewObject<UClass>( GetTransientPackage( ), strName, RF_Transient );
+            pClass->SetSuperStruct( const_cast<UClass*>( pSuperClass ) );
+            pClass->AddToRoot( );
+            rOutClasses.Add( pClass );
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void RunClassFilterBenchmarks( int32 nNumClasses,
+                                          int32 nNumObjects,
+                                          int32 nNumIterations,
+                                          TArray<FResult>& rOutResults )
+    {
+        // The class filters only read the class of the objects, they are benchmarked with synthesized classes to
+        // reach the class counts of large projects, whatever is loaded by the commandlet.
+        TArray<UClass*> oClasses;
+        CreateSyntheticClasses( nNumClasses, oClasses );
+
+        TArray<const UClass*> oObjectClasses;
+        oObjectClasses.Reserve( nNumObjects );
+
+        for( int32 nObject = 0; nObject < nNumObjects; ++nObject )
+        {
+            oObjectClasses.Add( oClasses[( nObject * 7919 ) % nNumClasses] );
+        }
+
+        auto oMeasure = [&]( const FString& rName, int32 nNumItems, TFunctionRef<void( )> oBody )
+        {
+            Measure( rName, nNumClasses, 1, nNumItems, nNumIterations, oBody, rOutResults );
+        };
+
+        for( int32 nFilterListSize : FilterListSizes )
+        {
+            // The first classes are the roots of the largest subtrees, the last one is a leaf.
+            TArray<const UClass*> oAllowedClasses;
+            TArray<const UClass*> oDisallowedClasses;
+
+            for( int32 nClass = 0; nClass < FMath::Min( nFilterListSize, nNumClasses ); ++nClass )
+            {
+                oAllowedClasses.Add( oClasses[nClass] );
+            }
+
+            oDisallowedClasses.Add( oClasses.Last( ) );
+
+            oMeasure( FString::Printf( TEXT( "SyntheticClassFilterLinear_%d" ), nFilterListSize ), nNumObjects, [&]( )
+            {
+                for( const UClass* pClass : oObjectClasses )
+                {
+                    IsFilteredClassLinear( pClass, oAllowedClasses, oDisallowedClasses );
+                }
+            } );
+
+            oMeasure( FString::Printf( TEXT( "SyntheticClassFilterCold_%d" ), nFilterListSize ), nNumClasses, [&]( )
+            {
+                const FComponentPickerClassFilter oFilter( oAllowedClasses, oDisallowedClasses );
+
+                for( const UClass* pClass : oClasses )
+                {
+                    oFilter.IsFilteredClass( pClass );
+                }
+            } );
+
+            const FComponentPickerClassFilter oWarmFilter( oAllowedClasses, oDisallowedClasses );
+
+            oMeasure( FString::Printf( TEXT( "SyntheticClassFilterWarm_%d" ), nFilterListSize ), nNumObjects, [&]( )
+            {
+                for( const UClass* pClass : oObjectClasses )
+                {
+                    oWarmFilter.IsFilteredClass( pClass );
+                }
+            } );
+
+            bool bSameVerdicts = true;
+
+            for( const UClass* pClass : oClasses )
+            {
+                bSameVerdicts &= oWarmFilter.IsFilteredClass( pClass ) ==
+                                 IsFilteredClassLinear( pClass, oAllowedClasses, oDisallowedClasses );
+            }
+
+            Verify( bSameVerdicts, FString::Printf( TEXT( "SyntheticClassFilter_%d" ), nFilterListSize ) );
+        }
+
+        for( UClass* pClass : oClasses )
+        {
+            pClass->RemoveFromRoot( );
+            pClass->MarkAsGarbage( );
+        }
+
+        CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void RunSearchBenchmarks( int32 nNumEntries, int32 nNumIterations, TArray<FResult>& rOutResults )
+    {
+        // The search index only holds strings, it is benchmarked without a world to reach the sizes of large
+        // World Partition maps.
+        auto oMakeEntries = [nNumEntries]( )
+        {
+            TArray<FComponentPickerSearchIndex::FEntry> oEntries;
+            oEntries.Reserve( nNumEntries );
+
+            for( int32 nEntry = 0; nEntry < nNumEntries; ++nEntry )
+            {
+                FComponentPickerSearchIndex::FEntry& rEntry = oEntries.AddDefaulted_GetRef( );
+                rEntry.nId = nEntry;
+                rEntry.strActorLabel = FString::Printf( TEXT( "StaticMeshActor%d" ), nEntry / 8 );
+                rEntry.strComponentName = FString::Printf( TEXT( "Component%d" ), nEntry % 8 );
+                rEntry.strVariableName = FString::Printf( TEXT( "Mesh%d" ), nEntry % 8 );
+            }
+
+            return oEntries;
+        };
+
+        auto oMeasure = [&]( const FString& rName, TFunctionRef<void( )> oBody )
+        {
+            Measure( rName, nNumEntries, 1, nNumEntries, nNumIterations, oBody, rOutResults );
+        };
+
+        TUniquePtr<FComponentPickerSearchIndex> pSearchIndex;
+
+        oMeasure( TEXT( "SearchIndexBuild" ), [&]( )
+        {
+            TArray<FComponentPickerSearchIndex::FEntry> oEntries = oMakeEntries( );
+            pSearchIndex = MakeUnique<FComponentPickerSearchIndex>( MoveTemp( oEntries ) );
+        } );
+
+        // Only the first results are kept, they must be the best of all the matches.
+        auto oVerifyTopResults = [&]( const FString& rQuery, const TArray<int32>& rIds, const FString& rName )
+        {
+            TArray<int32> oAllIds;
+            pSearchIndex->Query( rQuery, MAX_int32, oAllIds );
+            oAllIds.SetNum( FMath::Min( oAllIds.Num( ), SearchMaxResults ) );
+            Verify( rIds.Num( ) > 0 && rIds == oAllIds, rName );
+        };
+
+        // Fuzzy query, every entry shares trigrams with it.
+        TArray<int32> oIds;
+
+        oMeasure( TEXT( "SearchQuery" ), [&]( )
+        {
+            oIds.Reset( );
+            pSearchIndex->Query( TEXT( "meshactor12" ), SearchMaxResults, oIds );
+        } );
+
+        oVerifyTopResults( TEXT( "meshactor12" ), oIds, TEXT( "SearchQuery" ) );
+
+        // Queries shorter than a trigram, the first characters typed in the search box.
+        oMeasure( TEXT( "SearchQueryShort" ), [&]( )
+        {
+            oIds.Reset( );
+            pSearchIndex->Query( TEXT( "m" ), SearchMaxResults, oIds );
+            oIds.Reset( );
+            pSearchIndex->Query( TEXT( "me" ), SearchMaxResults, oIds );
+        } );
+
+        oVerifyTopResults( TEXT( "me" ), oIds, TEXT( "SearchQueryShort" ) );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static TArray<int32> ParseCounts( const FString& rParams, const TCHAR* pName, const TArray<int32>& rDefaultCounts )
+    {
+        FString strCounts;
+
+        if( !FParse::Value( *rParams, pName, strCounts, false ) )
+        {
+            return rDefaultCounts;
+        }
+
+        TArray<FString> oCountStrings;
+        strCounts.ParseIntoArray( oCountStrings, TEXT( "+" ) );
+
+        TArray<int32> oCounts;
+
+        for( const FString& rCountString : oCountStrings )
+        {
+            oCounts.Add( FMath::Max( 1, FCString::Atoi( *rCountString ) ) );
+        }
+
+        return oCounts;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool UComponentPickerBenchmarkPackageMap::SerializeObject( FArchive& rAr,
+                                                           UClass* pClass,
+                                                           UObject*& rObject,
+                                                           FNetworkGUID* pOutNetGUID )
+{
+    uint32 unIndex = 0;
+
+    if( rAr.IsSaving( ) && rObject != nullptr )
+    {
+        if( const uint32* pIndex = m_oObjectIndices.Find( rObject ) )
+        {
+            unIndex = *pIndex;
+        }
+        else
+        {
+            unIndex = m_oObjectIndices.Add( rObject, m_oObjects.Add( rObject ) + 1 );
+        }
+    }
+
+    rAr.SerializeIntPacked( unIndex );
+
+    if( rAr.IsLoading( ) )
+    {
+        const int32 nObject = static_cast<int32>( unIndex ) - 1;
+        rObject = m_oObjects.IsValidIndex( nObject ) ? m_oObjects[nObject] : nullptr;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UComponentPickerBenchmarkCommandlet::UComponentPickerBenchmarkCommandlet( )
+{
+    IsClient = false;
+    IsEditor = true;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int32 UComponentPickerBenchmarkCommandlet::Main( const FString& rParams )
+{
+    using namespace ComponentPickerBenchmark;
+
+    const TArray<int32> oActorCounts = ParseCounts( rParams, TEXT( "Actors=" ), { 100, 1000, 10000 } );
+    const TArray<int32> oComponentCounts = ParseCounts( rParams, TEXT( "Components=" ), { 4, 16 } );
+    const TArray<int32> oSearchEntryCounts = ParseCounts( rParams, TEXT( "SearchEntries=" ), { 10000, 500000 } );
+    const TArray<int32> oFilterClassCounts = ParseCounts( rParams, TEXT( "FilterClasses=" ), { 10000 } );
+
+    int32 nNumFilterObjects = 100000;
+    FParse::Value( *rParams, TEXT( "FilterObjects=" ), nNumFilterObjects );
+    nNumFilterObjects = FMath::Max( 1, nNumFilterObjects );
+
+    int32 nNumIterations = 10;
+    FParse::Value( *rParams, TEXT( "Iterations=" ), nNumIterations );
+    nNumIterations = FMath::Max( 1, nNumIterations );
+
+    FString strReportPath = FPaths::ProjectSavedDir( ) / TEXT( "ComponentPicker/Benchmark.json" );
+    FParse::Value( *rParams, TEXT( "Report=" ), strReportPath );
+
+    TArray<FResult> oResults;
+    GNumFailedChecks = 0;
+
+    for( int32 nNumActors : oActorCounts )
+    {
+        for( int32 nNumComponentsPerActor : oComponentCounts )
+        {
+            RunBenchmarks( nNumActors, nNumComponentsPerActor, nNumIterations, oResults );
+        }
+    }
+
+    for( int32 nNumSearchEntries : oSearchEntryCounts )
+    {
+        RunSearchBenchmarks( nNumSearchEntries, nNumIterations, oResults );
+    }
+
+    for( int32 nNumFilterClasses : oFilterClassCounts )
+    {
+        RunClassFilterBenchmarks( nNumFilterClasses, nNumFilterObjects, nNumIterations, oResults );
+    }
+
+    TArray<TSharedPtr<FJsonValue>> oJsonResults;
+
+    for( const FResult& rResult : oResults )
+    {
+        TSharedRef<FJsonObject> pJsonResult = MakeShared<FJsonObject>( );
+        pJsonResult->SetStringField( TEXT( "Name" ), rResult.strName );
+        pJsonResult->SetNumberField( TEXT( "Actors" ), rResult.nNumActors );
+        pJsonResult->SetNumberField( TEXT( "ComponentsPerActor" ), rResult.nNumComponentsPerActor );
+        pJsonResult->SetNumberField( TEXT( "Items" ), rResult.nNumItems );
+
+        if( rResult.nNumBits > 0 )
+        {
+            pJsonResult->SetNumberField( TEXT( "Bits" ), rResult.nNumBits );
+        }
+
+        pJsonResult->SetNumberField( TEXT( "MinMs" ), rResult.fMinMs );
+        pJsonResult->SetNumberField( TEXT( "MedianMs" ), rResult.fMedianMs );
+        pJsonResult->SetNumberField( TEXT( "MeanMs" ), rResult.fMeanMs );
+        pJsonResult->SetNumberField( TEXT( "MedianNsPerItem" ),
+                                     rResult.nNumItems > 0 ? rResult.fMedianMs * 1.0e6 / rResult.nNumItems : 0.0 );
+        oJsonResults.Add( MakeShared<FJsonValueObject>( pJsonResult ) );
+    }
+
+    TSharedRef<FJsonObject> pJsonReport = MakeShared<FJsonObject>( );
+    pJsonReport->SetStringField( TEXT( "Date" ), FDateTime::UtcNow( ).ToIso8601( ) );
+    pJsonReport->SetStringField( TEXT( "CPU" ), FPlatformMisc::GetCPUBrand( ).TrimStartAndEnd( ) );
+    pJsonReport->SetNumberField( TEXT( "Cores" ), FPlatformMisc::NumberOfCoresIncludingHyperthreads( ) );
+    pJsonReport->SetNumberField( TEXT( "Iterations" ), nNumIterations );
+    pJsonReport->SetArrayField( TEXT( "Results" ), oJsonResults );
+
+    FString strReport;
+    const TSharedRef<TJsonWriter<>> pJsonWriter = TJsonWriterFactory<>::Create( &strReport );
+    FJsonSerializer::Serialize( pJsonReport, pJsonWriter );
+
+    if( !FFileHelper::SaveStringToFile( strReport, *strReportPath ) )
+    {
+        UE_LOG( LogComponentPicker, Error, TEXT( "Could not write the report to %s" ), *strReportPath );
+        return 1;
+    }
+
+    UE_LOG( LogComponentPicker, Display, TEXT( "%d result(s) written to %s" ), oResults.Num( ), *strReportPath );
+
+    if( GNumFailedChecks > 0 )
+    {
+        UE_LOG( LogComponentPicker, Error, TEXT( "%d check(s) failed" ), GNumFailedChecks );
+        return 1;
+    }
+
+    return 0;
+}
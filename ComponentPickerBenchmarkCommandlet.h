@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "UObject/CoreNet.h"
+
+#include "ComponentPickerBenchmarkCommandlet.generated.h"
+
+// Headless benchmarks of the component picker, meant to be tracked over time on CI:
+//
+//   UnrealEditor-Cmd.exe <Project> -run=ComponentPickerBenchmark -nullrhi [-Actors=100+1000] [-Components=4+16]
+//                        [-SearchEntries=10000+500000] [-FilterClasses=10000] [-FilterObjects=100000]
+//                        [-Iterations=10] [-Report=<File>]
+//
+// For every actor/component count, a transient world with that many actors and components is created and the hot
+// paths of the picker are timed: building and querying the component index, from the level and from its cache file,
+// opening the picker widget (when Slate is initialized), the validation rules used by the picker filters, the class
+// filters with several list sizes, multi-selection reads and writes, serialization, network size and component
+// resolution. The search index is timed on its own, for every SearchEntries count, and so are the class filters, over
+// FilterObjects objects of FilterClasses synthesized classes. The results are written to a JSON file. Where a path
+// replaced an older implementation, both are timed and their results compared; the commandlet returns an error when a
+// check fails.
+UCLASS( )
+class UComponentPickerBenchmarkCommandlet : public UCommandlet
+{
+    GENERATED_BODY( )
+
+public:
+    UComponentPickerBenchmarkCommandlet( );
+
+    // START UCommandlet interface.
+    virtual int32 Main( const FString& rParams ) override;
+    // END UCommandlet interface.
+};
+
+// Package map of the network size benchmarks. Objects are sent as a packed index in a table shared by the writer and
+// the reader, as acknowledged network GUIDs are.
+UCLASS( Transient )
+class UComponentPickerBenchmarkPackageMap : public UPackageMap
+{
+    GENERATED_BODY( )
+
+public:
+    // START UPackageMap interface.
+    virtual bool SerializeObject( FArchive& rAr,
+                                  UClass* pClass,
+                                  UObject*& rObject,
+                                  FNetworkGUID* pOutNetGUID = nullptr ) override;
+    // END UPackageMap interface.
+
+private:
+    // Objects sent so far, and their index plus one (zero is null)
+    TArray<UObject*> m_oObjects;
+    TMap<UObject*, uint32> m_oObjectIndices;
+};
@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerCandidateCache.h"
+#include "ComponentPicker.h"
+#include "ComponentPickerCustomization.h"
+#include "ComponentPickerIndex.h"
+#include "SComponentPicker.h"
+
+#include "Async/Async.h"
+#include "Editor.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+static TAutoConsoleVariable<bool> CVarComponentPickerPrewarm(
+    TEXT( "ComponentPicker.Prewarm" ),
+    false,
+    TEXT( "Filter the candidates of a component picker in the background as soon as it is shown in a details panel, "
+          "so that its menu opens instantly." ) );
+
+// Maximum number of candidate sets kept.
+static const int32 CandidateCacheMaxEntries = 16;
+
+// Time in seconds the candidates are allowed to be filtered for per frame.
+static const double CandidateCacheSliceBudget = 0.001;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerCandidateCache& FComponentPickerCandidateCache::Get( )
+{
+    static FComponentPickerCandidateCache oCache;
+    return oCache;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerCandidateSetPtr FComponentPickerCandidateCache::Find(
+    const AActor* pOwnerActor,
+    bool bAllowAnyActor,
+    const TSharedPtr<const FComponentPickerClassFilters>& pClassFilters )
+{
+    if( !CVarComponentPickerPrewarm.GetValueOnGameThread( ) || pOwnerActor == nullptr || !pClassFilters.IsValid( ) )
+    {
+        return nullptr;
+    }
+
+    FKey oKey;
+    oKey.oOwnerActor = pOwnerActor;
+    oKey.pClassFilters = pClassFilters.Get( );
+    oKey.bAllowAnyActor = bAllowAnyActor;
+
+    FEntry* pEntry = m_oEntries.Find( oKey );
+
+    if( pEntry == nullptr ||
+        !pEntry->pCandidateSet.IsValid( ) ||
+        pEntry->nGeneration != FComponentPickerIndex::Get( ).GetGeneration( pOwnerActor->GetLevel( ) ) )
+    {
+        return nullptr;
+    }
+
+    pEntry->nLastUse = ++m_nLastUse;
+    return pEntry->pCandidateSet;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCandidateCache::Prewarm( const AActor* pOwnerActor,
+                                              bool bAllowAnyActor,
+                                              const TSharedPtr<const FComponentPickerClassFilters>& pClassFilters )
+{
+    if( !CVarComponentPickerPrewarm.GetValueOnGameThread( ) || pOwnerActor == nullptr || !pClassFilters.IsValid( ) )
+    {
+        return;
+    }
+
+    FKey oKey;
+    oKey.oOwnerActor = pOwnerActor;
+    oKey.pClassFilters = pClassFilters.Get( );
+    oKey.bAllowAnyActor = bAllowAnyActor;
+
+    const uint64 nGeneration = FComponentPickerIndex::Get( ).GetGeneration( pOwnerActor->GetLevel( ) );
+
+    if( FEntry* pEntry = m_oEntries.Find( oKey ) )
+    {
+        pEntry->nLastUse = ++m_nLastUse;
+
+        // A build in progress is not restarted, the next call picks up the changes made meanwhile.
+        if( pEntry->bBuilding || pEntry->nGeneration == nGeneration )
+        {
+            return;
+        }
+    }
+    else
+    {
+        MakeRoom( );
+    }
+
+    FEntry& rEntry = m_oEntries.FindOrAdd( oKey );
+    rEntry.pClassFilters = pClassFilters;
+    rEntry.nLastUse = ++m_nLastUse;
+    rEntry.bBuilding = true;
+
+    // The index has to be read on the game thread, the filtering is what takes time and is spread over frames.
+    TArray<UActorComponent*> oCandidates;
+
+    if( bAllowAnyActor )
+    {
+        FComponentPickerIndex::Get( ).GetComponents( pOwnerActor->GetLevel( ), oCandidates );
+    }
+    else
+    {
+        FComponentPickerIndex::Get( ).GetComponents( pOwnerActor, oCandidates );
+    }
+
+    FBuild& rBuild = m_oBuilds.AddDefaulted_GetRef( );
+    rBuild.oKey = oKey;
+    rBuild.nGeneration = nGeneration;
+    rBuild.pOwnerActor = pOwnerActor;
+    rBuild.bAllowAnyActor = bAllowAnyActor;
+    rBuild.pClassFilters = pClassFilters;
+    rBuild.oCandidates.Reserve( oCandidates.Num( ) );
+    rBuild.pCandidateSet = MakeShared<FComponentPickerCandidateSet, ESPMode::ThreadSafe>( );
+
+    for( UActorComponent* pComponent : oCandidates )
+    {
+        rBuild.oCandidates.Add( pComponent );
+    }
+
+    ScheduleSlice( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCandidateCache::BuildSlice( )
+{
+    m_bSliceScheduled = false;
+
+    const double fStartTime = FPlatformTime::Seconds( );
+
+    while( m_oBuilds.Num( ) > 0 && FPlatformTime::Seconds( ) - fStartTime < CandidateCacheSliceBudget )
+    {
+        FBuild& rBuild = m_oBuilds[0];
+        const AActor* pOwnerActor = rBuild.pOwnerActor.Get( );
+
+        // The validation rules, labels and search strings read the objects, they are gathered on the game thread.
+        while( pOwnerActor &&
+               rBuild.nNextCandidate < rBuild.oCandidates.Num( ) &&
+               FPlatformTime::Seconds( ) - fStartTime < CandidateCacheSliceBudget )
+        {
+            const TWeakObjectPtr<UActorComponent>& pWeakComponent = rBuild.oCandidates[rBuild.nNextCandidate++];
+            const UActorComponent* pComponent = pWeakComponent.Get( );
+
+            if( pComponent == nullptr ||
+                FComponentPickerCustomization::ValidateComponent( pComponent,
+                                                                  pOwnerActor,
+                                                                  rBuild.bAllowAnyActor,
+                                                                  *rBuild.pClassFilters ) !=
+                    EComponentPickerValidation::Valid )
+            {
+                continue;
+            }
+
+            FComponentPickerCandidateSet& rCandidateSet = *rBuild.pCandidateSet;
+
+            FComponentPickerSearchIndex::FEntry& rSearchEntry = rBuild.oSearchEntries.AddDefaulted_GetRef( );
+            SComponentPicker::GetSearchEntry( pComponent, rBuild.bAllowAnyActor, rSearchEntry );
+            rSearchEntry.nId = rCandidateSet.oComponents.Num( );
+
+            rCandidateSet.oComponents.Add( pWeakComponent );
+            rCandidateSet.oLabels.Add( SComponentPicker::GetComponentLabel( pComponent, rBuild.bAllowAnyActor ) );
+        }
+
+        if( pOwnerActor && rBuild.nNextCandidate < rBuild.oCandidates.Num( ) )
+        {
+            break;
+        }
+
+        FBuild oBuild = MoveTemp( rBuild );
+        m_oBuilds.RemoveAt( 0 );
+
+        // The owner was deleted meanwhile, the entry is built again if it is ever shown.
+        if( pOwnerActor == nullptr )
+        {
+            m_oEntries.Remove( oBuild.oKey );
+            continue;
+        }
+
+        // Only strings are left, the index is built off the game thread.
+        Async( EAsyncExecution::ThreadPool,
+               [oKey = oBuild.oKey,
+                nGeneration = oBuild.nGeneration,
+                nNumCandidates = oBuild.oCandidates.Num( ),
+                pCandidateSet = MoveTemp( oBuild.pCandidateSet ),
+                oSearchEntries = MoveTemp( oBuild.oSearchEntries )]( ) mutable
+        {
+            const double fIndexStartTime = FPlatformTime::Seconds( );
+
+            pCandidateSet->pSearchIndex =
+                MakeShared<const FComponentPickerSearchIndex, ESPMode::ThreadSafe>( MoveTemp( oSearchEntries ) );
+
+            UE_LOG( LogComponentPicker,
+                    Verbose,
+                    TEXT( "Prewarmed %d candidates out of %d, search index built in %.3f ms." ),
+                    pCandidateSet->oComponents.Num( ),
+                    nNumCandidates,
+                    ( FPlatformTime::Seconds( ) - fIndexStartTime ) * 1000.0 );
+
+            AsyncTask( ENamedThreads::GameThread, [oKey, nGeneration, pCandidateSet]( )
+            {
+                FComponentPickerCandidateCache::Get( ).OnBuilt( oKey, nGeneration, pCandidateSet );
+            } );
+        } );
+    }
+
+    if( m_oBuilds.Num( ) > 0 )
+    {
+        ScheduleSlice( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCandidateCache::ScheduleSlice( )
+{
+    if( m_bSliceScheduled )
+    {
+        return;
+    }
+
+    // Without an editor, e.g. in a commandlet, there are no frames to spread the work over.
+    if( GEditor == nullptr )
+    {
+        while( m_oBuilds.Num( ) > 0 )
+        {
+            BuildSlice( );
+        }
+
+        return;
+    }
+
+    m_bSliceScheduled = true;
+    GEditor->GetTimerManager( )->SetTimerForNextTick( FTimerDelegate::CreateLambda( []( )
+    {
+        FComponentPickerCandidateCache::Get( ).BuildSlice( );
+    } ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCandidateCache::OnBuilt( const FKey& rKey,
+                                              uint64 nGeneration,
+                                              FComponentPickerCandidateSetPtr pCandidateSet )
+{
+    if( FEntry* pEntry = m_oEntries.Find( rKey ) )
+    {
+        pEntry->pCandidateSet = pCandidateSet;
+        pEntry->nGeneration = nGeneration;
+        pEntry->bBuilding = false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCandidateCache::MakeRoom( )
+{
+    // Sets being built are never evicted, the work done so far would be lost.
+    while( m_oEntries.Num( ) >= CandidateCacheMaxEntries )
+    {
+        const FKey* pOldestKey = nullptr;
+        uint64 nOldestUse = MAX_uint64;
+
+        for( const TPair<FKey, FEntry>& rEntry : m_oEntries )
+        {
+            if( !rEntry.Value.bBuilding && rEntry.Value.nLastUse < nOldestUse )
+            {
+                pOldestKey = &rEntry.Key;
+                nOldestUse = rEntry.Value.nLastUse;
+            }
+        }
+
+        if( pOldestKey == nullptr )
+        {
+            return;
+        }
+
+        m_oEntries.Remove( FKey( *pOldestKey ) );
+    }
+}
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "ComponentPickerSearchIndex.h"
+
+#include "UObject/ObjectKey.h"
+
+class AActor;
+class UActorComponent;
+struct FComponentPickerClassFilters;
+
+// Candidates of a picker that passed its filters, with their labels and their search index.
+struct FComponentPickerCandidateSet
+{
+    TArray<TWeakObjectPtr<UActorComponent>> oComponents;
+    TArray<FText> oLabels;
+
+    // The ids of the entries are indices in oComponents.
+    TSharedPtr<const FComponentPickerSearchIndex, ESPMode::ThreadSafe> pSearchIndex;
+};
+
+typedef TSharedPtr<const FComponentPickerCandidateSet, ESPMode::ThreadSafe> FComponentPickerCandidateSetPtr;
+
+// Candidate sets built in the background as soon as a picker row is shown in a details panel, so that the menu opens
+// with every candidate already filtered and searchable. Opt-in with the ComponentPicker.Prewarm console variable.
+// The candidates are filtered and labelled on the game thread a slice per frame, only the search index is built on a
+// worker thread. A set is kept per owner actor and filters, and is dropped when the generation of its level in the
+// FComponentPickerIndex changes. The least recently used sets are evicted past a fixed number.
+class FComponentPickerCandidateCache
+{
+public:
+    // Get the global cache.
+    static FComponentPickerCandidateCache& Get( );
+
+    // Returns the candidates of a picker if they were built and its level has not changed since.
+    FComponentPickerCandidateSetPtr Find( const AActor* pOwnerActor,
+                                          bool bAllowAnyActor,
+                                          const TSharedPtr<const FComponentPickerClassFilters>& pClassFilters );
+
+    // Start building the candidates of a picker, unless they are up to date or already being built.
+    void Prewarm( const AActor* pOwnerActor,
+                  bool bAllowAnyActor,
+                  const TSharedPtr<const FComponentPickerClassFilters>& pClassFilters );
+
+private:
+    struct FKey
+    {
+        TObjectKey<AActor> oOwnerActor;
+        const FComponentPickerClassFilters* pClassFilters = nullptr;
+        bool bAllowAnyActor = false;
+
+        bool operator==( const FKey& rOther ) const
+        {
+            return oOwnerActor == rOther.oOwnerActor &&
+                pClassFilters == rOther.pClassFilters &&
+                bAllowAnyActor == rOther.bAllowAnyActor;
+        }
+
+        friend uint32 GetTypeHash( const FKey& rKey )
+        {
+            return HashCombine( HashCombine( GetTypeHash( rKey.oOwnerActor ), GetTypeHash( rKey.pClassFilters ) ),
+                                GetTypeHash( rKey.bAllowAnyActor ) );
+        }
+    };
+
+    struct FEntry
+    {
+        FComponentPickerCandidateSetPtr pCandidateSet;
+
+        // Keeps the filters the set was built with alive, even if the class filter cache is flushed
+        TSharedPtr<const FComponentPickerClassFilters> pClassFilters;
+
+        // Generation of the level the set was built from
+        uint64 nGeneration = 0;
+
+        uint64 nLastUse = 0;
+        bool bBuilding = false;
+    };
+
+    // A set whose candidates are being filtered on the game thread.
+    struct FBuild
+    {
+        FKey oKey;
+        uint64 nGeneration = 0;
+        TWeakObjectPtr<const AActor> pOwnerActor;
+        bool bAllowAnyActor = false;
+        TSharedPtr<const FComponentPickerClassFilters> pClassFilters;
+
+        // Candidates read from the index, and the next one to filter
+        TArray<TWeakObjectPtr<UActorComponent>> oCandidates;
+        int32 nNextCandidate = 0;
+
+        TSharedPtr<FComponentPickerCandidateSet, ESPMode::ThreadSafe> pCandidateSet;
+        TArray<FComponentPickerSearchIndex::FEntry> oSearchEntries;
+    };
+
+    // Filter the candidates of the builds in progress until the time budget of the frame is spent, the search index
+    // of the finished ones is built on a worker thread.
+    void BuildSlice( );
+
+    // Run BuildSlice on the next frame.
+    void ScheduleSlice( );
+
+    // Store a set built by Prewarm.
+    void OnBuilt( const FKey& rKey, uint64 nGeneration, FComponentPickerCandidateSetPtr pCandidateSet );
+
+    // Evict the least recently used sets until there is room for a new one.
+    void MakeRoom( );
+
+private:
+    TMap<FKey, FEntry> m_oEntries;
+    uint64 m_nLastUse = 0;
+
+    // Builds in progress, oldest first.
+    TArray<FBuild> m_oBuilds;
+    bool m_bSliceScheduled = false;
+};
@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerClassFilter.h"
+#include "ComponentPickerStats.h"
+
+#include "Components/ActorComponent.h"
+#include "GameFramework/Actor.h"
+#include "Misc/CoreDelegates.h"
+#include "UObject/UObjectIterator.h"
+
+static TUniquePtr<FComponentPickerClassFilterCache> GComponentPickerClassFilterCache;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerClassFilter::FComponentPickerClassFilter( const TArray<const UClass*>& rAllowedClasses,
+                                                          const TArray<const UClass*>& rDisallowedClasses )
+    : m_oAllowedClasses( rAllowedClasses )
+    , m_oDisallowedClasses( rDisallowedClasses )
+{
+    // Empty
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerClassFilter::FComponentPickerClassFilter( const FComponentPickerClassFilter& rOther )
+    : m_oAllowedClasses( rOther.m_oAllowedClasses )
+    , m_oDisallowedClasses( rOther.m_oDisallowedClasses )
+{
+    // Empty
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerClassFilter& FComponentPickerClassFilter::operator=( const FComponentPickerClassFilter& rOther )
+{
+    if( this != &rOther )
+    {
+        FRWScopeLock oLock( m_oClassVerdictsLock, SLT_Write );
+
+        m_oAllowedClasses = rOther.m_oAllowedClasses;
+        m_oDisallowedClasses = rOther.m_oDisallowedClasses;
+        m_oClassVerdicts.Reset( );
+    }
+
+    return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerClassFilter::IsFilteredClass( const UClass* pClass ) const
+{
+    if( IsEmpty( ) )
+    {
+        return true;
+    }
+
+    {
+        FRWScopeLock oLock( m_oClassVerdictsLock, SLT_ReadOnly );
+
+        if( const bool* pVerdict = m_oClassVerdicts.Find( TObjectKey<UClass>( pClass ) ) )
+        {
+            FComponentPickerStats::Increment( FComponentPickerStats::ECounter::ClassVerdictHits );
+            return *pVerdict;
+        }
+    }
+
+    FComponentPickerStats::Increment( FComponentPickerStats::ECounter::ClassVerdictMisses );
+    const bool bVerdict = EvaluateClass( pClass );
+
+    FRWScopeLock oLock( m_oClassVerdictsLock, SLT_Write );
+    m_oClassVerdicts.Add( TObjectKey<UClass>( pClass ), bVerdict );
+
+    return bVerdict;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerClassFilter::IsEmpty( ) const
+{
+    return m_oAllowedClasses.Num( ) == 0 && m_oDisallowedClasses.Num( ) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerClassFilter::EvaluateClass( const UClass* pClass ) const
+{
+    bool bAllowedToSetBasedOnFilter = true;
+
+    if( m_oAllowedClasses.Num( ) > 0 )
+    {
+        bAllowedToSetBasedOnFilter = false;
+
+        for( const UClass* pAllowedClass : m_oAllowedClasses )
+        {
+            const bool bAllowedClassIsInterface = pAllowedClass->HasAnyClassFlags( CLASS_Interface );
+
+            if( pClass->IsChildOf( pAllowedClass ) ||
+                ( bAllowedClassIsInterface && pClass->ImplementsInterface( pAllowedClass ) ) )
+            {
+                bAllowedToSetBasedOnFilter = true;
+                break;
+            }
+        }
+    }
+
+    if( m_oDisallowedClasses.Num( ) > 0 && bAllowedToSetBasedOnFilter )
+    {
+        for( const UClass* pDisallowedClass : m_oDisallowedClasses )
+        {
+            const bool bDisallowedClassIsInterface = pDisallowedClass->HasAnyClassFlags( CLASS_Interface );
+
+            if( pClass->IsChildOf( pDisallowedClass ) ||
+                ( bDisallowedClassIsInterface && pClass->ImplementsInterface( pDisallowedClass ) ) )
+            {
+                bAllowedToSetBasedOnFilter = false;
+                break;
+            }
+        }
+    }
+
+    return bAllowedToSetBasedOnFilter;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerClassFilterCache& FComponentPickerClassFilterCache::Get( )
+{
+    if( !GComponentPickerClassFilterCache.IsValid( ) )
+    {
+        GComponentPickerClassFilterCache = MakeUnique<FComponentPickerClassFilterCache>( );
+
+        // Unregister from the engine delegates before they are destroyed.
+        FCoreDelegates::OnPreExit.AddLambda( []( )
+        {
+            GComponentPickerClassFilterCache.Reset( );
+        } );
+    }
+
+    return *GComponentPickerClassFilterCache;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerClassFilterCache::FComponentPickerClassFilterCache( )
+{
+    m_hModulesChanged =
+        FModuleManager::Get( ).OnModulesChanged( ).AddRaw( this, &FComponentPickerClassFilterCache::OnModulesChanged );
+    m_hReloadComplete =
+        FCoreUObjectDelegates::ReloadCompleteDelegate.AddRaw( this, &FComponentPickerClassFilterCache::OnReloadComplete );
+    m_hObjectsReplaced =
+        FCoreUObjectDelegates::OnObjectsReplaced.AddRaw( this, &FComponentPickerClassFilterCache::OnObjectsReplaced );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerClassFilterCache::~FComponentPickerClassFilterCache( )
+{
+    FModuleManager::Get( ).OnModulesChanged( ).Remove( m_hModulesChanged );
+    FCoreUObjectDelegates::ReloadCompleteDelegate.Remove( m_hReloadComplete );
+    FCoreUObjectDelegates::OnObjectsReplaced.Remove( m_hObjectsReplaced );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<const FComponentPickerClassFilters> FComponentPickerClassFilterCache::FindOrBuild(
+    const FString& rAllowedClasses,
+    const FString& rDisallowedClasses,
+    bool bAllowAnyActor,
+    const UClass* pRequiredComponentClass )
+{
+    // AllowAnyActor changes whether actor classes are kept, so it is part of the key.
+    const FString strRequiredComponentClass =
+        pRequiredComponentClass ? pRequiredComponentClass->GetPathName( ) : FString( );
+    const FString strKey = FString::Printf( TEXT( "%s|%s|%d|%s" ),
+                                            *rAllowedClasses,
+                                            *rDisallowedClasses,
+                                            bAllowAnyActor ? 1 : 0,
+                                            *strRequiredComponentClass );
+
+    if( const TSharedRef<const FComponentPickerClassFilters>* pFilters = m_oFilters.Find( strKey ) )
+    {
+        FComponentPickerStats::Increment( FComponentPickerStats::ECounter::FilterCacheHits );
+        return *pFilters;
+    }
+
+    FComponentPickerStats::Increment( FComponentPickerStats::ECounter::FilterCacheMisses );
+
+    return m_oFilters.Add( strKey,
+                           Build( rAllowedClasses, rDisallowedClasses, bAllowAnyActor, pRequiredComponentClass ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerClassFilterCache::Invalidate( )
+{
+    m_oFilters.Reset( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<const FComponentPickerClassFilters> FComponentPickerClassFilterCache::Build(
+    const FString& rAllowedClasses,
+    const FString& rDisallowedClasses,
+    bool bAllowAnyActor,
+    const UClass* pRequiredComponentClass )
+{
+    auto oAddToClassFilters = [bAllowAnyActor]( const UClass* Class,
+                                                TArray<const UClass*>& ActorList,
+                                                TArray<const UClass*>& ComponentList )
+    {
+        // Interfaces are kept as is, EvaluateClass checks ImplementsInterface so classes loaded later still match.
+        // They only go in the lists of the kinds implementing them: an interface of components in the actor list
+        // would filter out every owner.
+        if( Class->HasAnyClassFlags( CLASS_Interface ) )
+        {
+            bool bImplementedByActors = false;
+            bool bImplementedByComponents = false;
+
+            for( TObjectIterator<UClass> ClassIt; ClassIt && !( bImplementedByActors && bImplementedByComponents );
+                 ++ClassIt )
+            {
+                if( ClassIt->ImplementsInterface( Class ) )
+                {
+                    bImplementedByActors |= ClassIt->IsChildOf( AActor::StaticClass( ) );
+                    bImplementedByComponents |= ClassIt->IsChildOf( UActorComponent::StaticClass( ) );
+                }
+            }
+
+            if( bAllowAnyActor && bImplementedByActors )
+            {
+                ActorList.Add( Class );
+            }
+
+            if( bImplementedByComponents )
+            {
+                ComponentList.Add( Class );
+            }
+        }
+        else if( bAllowAnyActor && Class->IsChildOf( AActor::StaticClass( ) ) )
+        {
+            ActorList.Add( Class );
+        }
+        else if( Class->IsChildOf( UActorComponent::StaticClass( ) ) )
+        {
+            ComponentList.Add( Class );
+        }
+    };
+
+    auto oParseClassFilters = [oAddToClassFilters]( const FString& MetaDataString,
+                                                    TArray<const UClass*>& ActorList,
+                                                    TArray<const UClass*>& ComponentList )
+    {
+        if( !MetaDataString.IsEmpty( ) )
+        {
+            TArray<FString> ClassFilterNames;
+            MetaDataString.ParseIntoArrayWS( ClassFilterNames, TEXT( "," ), true );
+
+            for( const FString& ClassName : ClassFilterNames )
+            {
+                UClass* Class = FindObject<UClass>( ANY_PACKAGE, *ClassName );
+
+                if( !Class )
+                {
+                    Class = LoadObject<UClass>( nullptr, *ClassName );
+                }
+
+                if( Class )
+                {
+                    oAddToClassFilters( Class, ActorList, ComponentList );
+                }
+            }
+        }
+    };
+
+    TArray<const UClass*> oAllowedActorClassFilters;
+    TArray<const UClass*> oAllowedComponentClassFilters;
+    TArray<const UClass*> oDisallowedActorClassFilters;
+    TArray<const UClass*> oDisallowedComponentClassFilters;
+
+    if( pRequiredComponentClass )
+    {
+        // The allowed class is known at compile time, there is nothing to parse.
+        oAllowedComponentClassFilters.Add( pRequiredComponentClass );
+    }
+    else
+    {
+        oParseClassFilters( rAllowedClasses, oAllowedActorClassFilters, oAllowedComponentClassFilters );
+    }
+
+    oParseClassFilters( rDisallowedClasses, oDisallowedActorClassFilters, oDisallowedComponentClassFilters );
+
+    TSharedRef<FComponentPickerClassFilters> pFilters = MakeShared<FComponentPickerClassFilters>( );
+    pFilters->oActorFilter = FComponentPickerClassFilter( oAllowedActorClassFilters, oDisallowedActorClassFilters );
+    pFilters->oComponentFilter =
+        FComponentPickerClassFilter( oAllowedComponentClassFilters, oDisallowedComponentClassFilters );
+
+    return pFilters;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerClassFilterCache::OnModulesChanged( FName strModuleName, EModuleChangeReason eReason )
+{
+    // Newly loaded modules can define filtered classes that could not be found before.
+    if( eReason == EModuleChangeReason::ModuleLoaded )
+    {
+        Invalidate( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerClassFilterCache::OnReloadComplete( EReloadCompleteReason eReason )
+{
+    // Hot reload and Live Coding.
+    Invalidate( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerClassFilterCache::OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap )
+{
+    // Reinstanced classes (e.g. after a Blueprint compile) invalidate the class pointers held by the filters.
+    for( const TPair<UObject*, UObject*>& rReplacement : rReplacementMap )
+    {
+        if( Cast<UClass>( rReplacement.Key ) != nullptr )
+        {
+            Invalidate( );
+            break;
+        }
+    }
+}
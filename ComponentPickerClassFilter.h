@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Modules/ModuleManager.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/UObjectGlobals.h"
+
+class UClass;
+
+// Compiled form of the AllowedClasses/DisallowedClasses metadata for one kind of object (actors or components).
+// The verdict of each class is computed once by walking the filter lists, every following check of an object of the
+// same class is a single map lookup. Checks can be made from several threads.
+class FComponentPickerClassFilter
+{
+public:
+    // Default constructor, lets every class through.
+    FComponentPickerClassFilter( ) = default;
+
+    // The verdicts are not copied, they are computed again by the copy.
+    FComponentPickerClassFilter( const FComponentPickerClassFilter& rOther );
+    FComponentPickerClassFilter& operator=( const FComponentPickerClassFilter& rOther );
+
+    // Construct from the classes listed in the metadata.
+    FComponentPickerClassFilter( const TArray<const UClass*>& rAllowedClasses,
+                                 const TArray<const UClass*>& rDisallowedClasses );
+
+    // Returns whether objects of this class pass the filter.
+    bool IsFilteredClass( const UClass* pClass ) const;
+
+    // Returns true if neither allowed nor disallowed classes were specified.
+    bool IsEmpty( ) const;
+
+private:
+    // Walk the filter lists to compute the verdict of a class.
+    bool EvaluateClass( const UClass* pClass ) const;
+
+private:
+    TArray<const UClass*> m_oAllowedClasses;
+    TArray<const UClass*> m_oDisallowedClasses;
+
+    // Verdict of every class evaluated so far. The filters outlive the cache flushes, the key tells apart a class
+    // allocated where a garbage collected one was.
+    mutable TMap<TObjectKey<UClass>, bool> m_oClassVerdicts;
+    mutable FRWLock m_oClassVerdictsLock;
+};
+
+// The actor and component filters built from the metadata of a property.
+struct FComponentPickerClassFilters
+{
+    FComponentPickerClassFilter oActorFilter;
+    FComponentPickerClassFilter oComponentFilter;
+};
+
+// Process-wide cache of the filters parsed from the AllowedClasses/DisallowedClasses metadata. All the properties
+// sharing the same metadata share the same filters. The cache is flushed when modules are loaded, on hot reload and
+// Live Coding, and when classes are reinstanced.
+class FComponentPickerClassFilterCache
+{
+public:
+    // Get the global cache.
+    static FComponentPickerClassFilterCache& Get( );
+
+    FComponentPickerClassFilterCache( );
+    ~FComponentPickerClassFilterCache( );
+
+    // Find the filters built for this metadata, parse the metadata if they do not exist yet. When a required
+    // component class is given (typed pickers), it is used instead of the AllowedClasses metadata.
+    TSharedRef<const FComponentPickerClassFilters> FindOrBuild( const FString& rAllowedClasses,
+                                                                const FString& rDisallowedClasses,
+                                                                bool bAllowAnyActor,
+                                                                const UClass* pRequiredComponentClass = nullptr );
+
+    // Flush every cached filter.
+    void Invalidate( );
+
+private:
+    // Parse the metadata into filters.
+    static TSharedRef<const FComponentPickerClassFilters> Build( const FString& rAllowedClasses,
+                                                                 const FString& rDisallowedClasses,
+                                                                 bool bAllowAnyActor,
+                                                                 const UClass* pRequiredComponentClass );
+
+    // Engine callbacks.
+    void OnModulesChanged( FName strModuleName, EModuleChangeReason eReason );
+    void OnReloadComplete( EReloadCompleteReason eReason );
+    void OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap );
+
+private:
+    TMap<FString, TSharedRef<const FComponentPickerClassFilters>> m_oFilters;
+
+    FDelegateHandle m_hModulesChanged;
+    FDelegateHandle m_hReloadComplete;
+    FDelegateHandle m_hObjectsReplaced;
+};
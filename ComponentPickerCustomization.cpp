@@ -2,32 +2,154 @@
 
 #include "ComponentPickerCustomization.h"
 #include "ComponentPicker.h"
+#include "ComponentPickerCandidateCache.h"
+#include "ComponentPickerStats.h"
 #include "SComponentPicker.h"
 
+#include "Async/ParallelFor.h"
 #include "DetailLayoutBuilder.h"
+#include "Editor.h"
 #include "Engine/LevelScriptActor.h"
+#include "Framework/Application/IMenu.h"
+#include "Framework/Application/SlateApplication.h"
+#include "HAL/ThreadSafeBool.h"
 #include "IDetailChildrenBuilder.h"
 #include "Kismet2/ComponentEditorUtils.h"
+#include "Misc/CoreDelegates.h"
+#include "ScopedTransaction.h"
 #include "Styling/SlateIconFinder.h"
 #include "Widgets/Layout/SWidgetSwitcher.h"
 
-static const FName NAME_AllowAnyActor = "AllowAnyActor";
-static const FName NAME_AllowedClasses = "AllowedClasses";
-static const FName NAME_DisallowedClasses = "DisallowedClasses";
+const FName FComponentPickerCustomization::NAME_AllowAnyActor = "AllowAnyActor";
+const FName FComponentPickerCustomization::NAME_AllowUnloadedActors = "AllowUnloadedActors";
+const FName FComponentPickerCustomization::NAME_AllowedClasses = "AllowedClasses";
+const FName FComponentPickerCustomization::NAME_DisallowedClasses = "DisallowedClasses";
+
+// Component classes of the structs registered with RegisterTypedCustomization, by struct name.
+static TMap<FName, const UClass*> GTypedPickerClasses;
+
+// Number of edited values compared by each task of GetValue.
+static const int32 GetValueChunkSize = 1024;
+
+// Handle of the row extension added by RegisterArrayRowExtension.
+static FDelegateHandle GArrayRowExtension;
 
 #define LOCTEXT_NAMESPACE "ComponentPickerCustomization"
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64 FComponentPickerCustomization::GetNumAvoidedRevalidations( )
+{
+    return FComponentPickerStats::Get( FComponentPickerStats::ECounter::AvoidedRevalidations );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const UClass* FComponentPickerCustomization::FindTypedPickerClass( const UStruct* pStruct )
+{
+    for( ; pStruct != nullptr && pStruct != FComponentPicker::StaticStruct( ); pStruct = pStruct->GetSuperStruct( ) )
+    {
+        if( const UClass* const* pComponentClass = GTypedPickerClasses.Find( pStruct->GetFName( ) ) )
+        {
+            return *pComponentClass;
+        }
+    }
+
+    return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::AddTypedPickerClass( const UStruct* pStruct, const UClass* pComponentClass )
+{
+    GTypedPickerClasses.Add( pStruct->GetFName( ), pComponentClass );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::RegisterArrayRowExtension( FPropertyEditorModule& rPropertyModule )
+{
+    if( !GArrayRowExtension.IsValid( ) )
+    {
+        GArrayRowExtension = rPropertyModule.GetGlobalRowExtensionDelegate( ).AddStatic(
+            &FComponentPickerCustomization::OnGenerateArrayRowExtension );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::UnregisterArrayRowExtension( FPropertyEditorModule& rPropertyModule )
+{
+    rPropertyModule.GetGlobalRowExtensionDelegate( ).Remove( GArrayRowExtension );
+    GArrayRowExtension.Reset( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::OnGenerateArrayRowExtension( const FOnGenerateGlobalRowExtensionArgs& rArgs,
+                                                                 TArray<FPropertyRowExtensionButton>& rOutExtensions )
+{
+    const TSharedPtr<IPropertyHandle>& pPropertyHandle = rArgs.PropertyHandle;
+
+    if( !pPropertyHandle.IsValid( ) || !pPropertyHandle->IsValidHandle( ) )
+    {
+        return;
+    }
+
+    // Every row of every details panel goes through here, the other properties are rejected from their class only.
+    const FArrayProperty* pArrayProperty = CastField<FArrayProperty>( pPropertyHandle->GetProperty( ) );
+    const FStructProperty* pInnerProperty =
+        pArrayProperty ? CastField<FStructProperty>( pArrayProperty->Inner ) : nullptr;
+
+    if( pInnerProperty == nullptr || !pInnerProperty->Struct->IsChildOf( FComponentPicker::StaticStruct( ) ) )
+    {
+        return;
+    }
+
+    // The instance lives as long as the button holding it.
+    TSharedRef<FComponentPickerCustomization> pCustomization =
+        MakeArrayInstance( pPropertyHandle.ToSharedRef( ), pInnerProperty->Struct );
+
+    FPropertyRowExtensionButton& rButton = rOutExtensions.AddDefaulted_GetRef( );
+    rButton.Icon = FSlateIcon( FEditorStyle::GetStyleSetName( ), "Icons.Plus" );
+    rButton.Label = LOCTEXT( "MultiPick_Label", "Pick Elements" );
+    rButton.ToolTip = LOCTEXT( "MultiPick_Tooltip", "Pick every element of the array at once" );
+    rButton.UIAction = FUIAction(
+        FExecuteAction::CreateLambda( [pCustomization]( ) { pCustomization->OpenMultiPickMenu( ); } ),
+        FCanExecuteAction::CreateSP( pCustomization, &FComponentPickerCustomization::CanEdit ) );
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TSharedRef<IPropertyTypeCustomization> FComponentPickerCustomization::MakeInstance( )
 {
     return MakeShareable( new FComponentPickerCustomization );
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<FComponentPickerCustomization> FComponentPickerCustomization::MakeArrayInstance(
+    TSharedRef<IPropertyHandle> pArrayHandle,
+    const UStruct* pElementStruct )
+{
+    TSharedRef<FComponentPickerCustomization> pCustomization = MakeShareable( new FComponentPickerCustomization );
+    pCustomization->m_pPropertyHandle = pArrayHandle;
+    pCustomization->m_pRequiredComponentClass = FindTypedPickerClass( pElementStruct );
+    pCustomization->m_bAllowClear = false;
+    pCustomization->m_bAllowAnyActor = pArrayHandle->HasMetaData( NAME_AllowAnyActor );
+    pCustomization->BuildClassFilters( );
+
+    return pCustomization;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerCustomization::~FComponentPickerCustomization( )
+{
+    FCoreUObjectDelegates::OnObjectRenamed.Remove( m_hObjectRenamed );
+    FCoreUObjectDelegates::OnObjectPropertyChanged.Remove( m_hObjectPropertyChanged );
+    FCoreUObjectDelegates::OnObjectsReplaced.Remove( m_hObjectsReplaced );
+    FCoreDelegates::OnActorLabelChanged.Remove( m_hActorLabelChanged );
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void FComponentPickerCustomization::CustomizeHeader( TSharedRef<IPropertyHandle> pInPropertyHandle,
                                                      FDetailWidgetRow& rHeaderRow,
                                                      IPropertyTypeCustomizationUtils& rCustomizationUtils )
 {
+    COMPONENT_PICKER_SCOPE( CustomizeHeader );
+
     m_pPropertyHandle = pInPropertyHandle;
 
     m_pCachedComponent.Reset( );
@@ -37,10 +159,12 @@ void FComponentPickerCustomization::CustomizeHeader( TSharedRef<IPropertyHandle>
     FProperty* pProperty = pInPropertyHandle->GetProperty( );
 
     check( CastField<FStructProperty>( pProperty ) &&
-           FComponentPicker::StaticStruct( ) == CastFieldChecked<const FStructProperty>( pProperty )->Struct );
+           CastFieldChecked<const FStructProperty>( pProperty )->Struct->IsChildOf(
+               FComponentPicker::StaticStruct( ) ) );
 
     m_bAllowClear = !( pInPropertyHandle->GetMetaDataProperty( )->PropertyFlags & CPF_NoClear );
     m_bAllowAnyActor = pInPropertyHandle->HasMetaData( NAME_AllowAnyActor );
+    m_bAllowUnloadedActors = m_bAllowAnyActor && pInPropertyHandle->HasMetaData( NAME_AllowUnloadedActors );
 
     BuildClassFilters( );
     BuildComboBox( );
@@ -65,6 +189,27 @@ void FComponentPickerCustomization::CustomizeHeader( TSharedRef<IPropertyHandle>
                 m_pCachedComponent.Reset( );
             }
         }
+
+        UpdateDisplayCache( );
+    }
+
+    if( !m_hObjectRenamed.IsValid( ) )
+    {
+        m_hObjectRenamed = FCoreUObjectDelegates::OnObjectRenamed.AddSP(
+            this, &FComponentPickerCustomization::OnObjectRenamed );
+        m_hObjectPropertyChanged = FCoreUObjectDelegates::OnObjectPropertyChanged.AddSP(
+            this, &FComponentPickerCustomization::OnObjectPropertyChanged );
+        m_hObjectsReplaced = FCoreUObjectDelegates::OnObjectsReplaced.AddSP(
+            this, &FComponentPickerCustomization::OnObjectsReplaced );
+        m_hActorLabelChanged = FCoreDelegates::OnActorLabelChanged.AddSP(
+            this, &FComponentPickerCustomization::OnActorLabelChanged );
+    }
+
+    // Unloaded actors are listed by the picker itself, their candidates can't be filtered ahead of time.
+    if( !m_bAllowUnloadedActors )
+    {
+        FComponentPickerCandidateCache::Get( ).Prewarm(
+            m_pCachedFirstOuterActor.Get( ), m_bAllowAnyActor, m_pClassFilters );
     }
 
     rHeaderRow.NameContent( )
@@ -105,72 +250,14 @@ void FComponentPickerCustomization::CustomizeChildren( TSharedRef<IPropertyHandl
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void FComponentPickerCustomization::BuildClassFilters( )
 {
-    auto oAddToClassFilters = [this]( const UClass* Class,
-                                      TArray<const UClass*>& ActorList,
-                                      TArray<const UClass*>& ComponentList )
-    {
-        if( m_bAllowAnyActor && Class->IsChildOf( AActor::StaticClass( ) ) )
-        {
-            ActorList.Add( Class );
-        }
-        else if( Class->IsChildOf( UActorComponent::StaticClass( ) ) )
-        {
-            ComponentList.Add( Class );
-        }
-    };
-
-    auto oParseClassFilters = [this, oAddToClassFilters]( const FString& MetaDataString,
-                                                          TArray<const UClass*>& ActorList,
-                                                          TArray<const UClass*>& ComponentList )
-    {
-        if( !MetaDataString.IsEmpty( ) )
-        {
-            TArray<FString> ClassFilterNames;
-            MetaDataString.ParseIntoArrayWS( ClassFilterNames, TEXT( "," ), true );
-
-            for( const FString& ClassName : ClassFilterNames )
-            {
-                UClass* Class = FindObject<UClass>( ANY_PACKAGE, *ClassName );
-
-                if( !Class )
-                {
-                    Class = LoadObject<UClass>( nullptr, *ClassName );
-                }
-
-                if( Class )
-                {
-                    // If the class is an interface, expand it to be all classes in memory that implement the class.
-                    if( Class->HasAnyClassFlags( CLASS_Interface ) )
-                    {
-                        for( TObjectIterator<UClass> ClassIt; ClassIt; ++ClassIt )
-                        {
-                            UClass* const ClassWithInterface = ( *ClassIt );
-
-                            if( ClassWithInterface->ImplementsInterface( Class ) )
-                            {
-                                oAddToClassFilters( ClassWithInterface, ActorList, ComponentList );
-                            }
-                        }
-                    }
-                    else
-                    {
-                        oAddToClassFilters( Class, ActorList, ComponentList );
-                    }
-                }
-            }
-        }
-    };
-
-    // Account for the allowed classes specified in the property metadata
-    const FString& strAllowedClassesFilterString = m_pPropertyHandle->GetMetaData( NAME_AllowedClasses );
-    oParseClassFilters( strAllowedClassesFilterString,
-                        m_oAllowedActorClassFilters,
-                        m_oAllowedComponentClassFilters );
-
-    const FString& strDisallowedClassesFilterString = m_pPropertyHandle->GetMetaData( NAME_DisallowedClasses );
-    oParseClassFilters( strDisallowedClassesFilterString,
-                        m_oDisallowedActorClassFilters,
-                        m_oDisallowedComponentClassFilters );
+    COMPONENT_PICKER_SCOPE( BuildClassFilters );
+
+    // Account for the allowed and disallowed classes specified in the property metadata
+    m_pClassFilters = FComponentPickerClassFilterCache::Get( ).FindOrBuild(
+        m_pPropertyHandle->GetMetaData( NAME_AllowedClasses ),
+        m_pPropertyHandle->GetMetaData( NAME_DisallowedClasses ),
+        m_bAllowAnyActor,
+        m_pRequiredComponentClass );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -331,6 +418,8 @@ AActor* FComponentPickerCustomization::GetFirstOuterActor( ) const
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void FComponentPickerCustomization::SetValue( const FComponentPicker& rValue )
 {
+    COMPONENT_PICKER_SCOPE( SetValue );
+
     m_pComponentComboButton->SetIsOpen( false );
 
     const bool bIsEmpty = rValue.GetComponent( ) == nullptr;
@@ -338,21 +427,201 @@ void FComponentPickerCustomization::SetValue( const FComponentPicker& rValue )
 
     if( bIsEmpty || bAllowedToSetBasedOnFilter )
     {
-        FString strTextValue;
-        CastFieldChecked<const FStructProperty>( m_pPropertyHandle->GetProperty( ) )->Struct->ExportText(
-            strTextValue,
-            &rValue,
-            &rValue,
-            nullptr,
-            EPropertyPortFlags::PPF_None,
-            nullptr );
-        ensure( m_pPropertyHandle->SetValueFromFormattedString( strTextValue ) == FPropertyAccess::Result::Success );
+        // Write the value directly in the raw data of every edited object instead of exporting it to text and
+        // parsing it back once per object. The pre/post change notifications are only sent once for the whole batch.
+        const FScopedTransaction oTransaction( FText::Format( LOCTEXT( "SetComponentPicker", "Set {0}" ),
+                                                              m_pPropertyHandle->GetPropertyDisplayName( ) ) );
+
+        m_pPropertyHandle->NotifyPreChange( );
+
+        TArray<void*> oRawData;
+        m_pPropertyHandle->AccessRawData( oRawData );
+        WriteRawValues( oRawData, rValue );
+
+        m_pPropertyHandle->NotifyPostChange( EPropertyChangeType::ValueSet );
+        m_pPropertyHandle->NotifyFinishedChangingProperties( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::WriteRawValues( TArrayView<void* const> oRawData, const FComponentPicker& rValue )
+{
+    for( void* pRawPtr : oRawData )
+    {
+        if( pRawPtr )
+        {
+            *reinterpret_cast<FComponentPicker*>( pRawPtr ) = rValue;
+        }
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::SetArrayValues( const TArray<UActorComponent*>& rComponents )
+{
+    COMPONENT_PICKER_SCOPE( SetValue );
+
+    const FArrayProperty* pArrayProperty =
+        m_pPropertyHandle.IsValid( ) ? CastField<FArrayProperty>( m_pPropertyHandle->GetProperty( ) ) : nullptr;
+
+    if( pArrayProperty == nullptr )
+    {
+        return;
+    }
+
+    m_pCachedFirstOuterActor = GetFirstOuterActor( );
+
+    TSet<const UActorComponent*> oPickedComponents;
+    oPickedComponents.Reserve( rComponents.Num( ) );
+
+    for( UActorComponent* pComponent : rComponents )
+    {
+        if( IsComponentPickerValid( FComponentPicker( pComponent ) ) )
+        {
+            oPickedComponents.Add( pComponent );
+        }
+    }
+
+    const bool bFixedSize = pArrayProperty->HasAnyPropertyFlags( CPF_EditFixedSize );
+    const FComponentPicker oEmptyValue;
+    int32 nNumDroppedPicks = 0;
+
+    // As in SetValue, the arrays are written directly, with a single transaction and change notification instead
+    // of one per element.
+    const FScopedTransaction oTransaction( FText::Format( LOCTEXT( "SetComponentPickerArray", "Set {0}" ),
+                                                          m_pPropertyHandle->GetPropertyDisplayName( ) ) );
+
+    m_pPropertyHandle->NotifyPreChange( );
+
+    TArray<void*> oRawData;
+    m_pPropertyHandle->AccessRawData( oRawData );
+
+    for( void* pRawPtr : oRawData )
+    {
+        if( pRawPtr == nullptr )
+        {
+            continue;
+        }
+
+        FScriptArrayHelper oArrayHelper( pArrayProperty, pRawPtr );
+
+        // Typed pickers don't add members to FComponentPicker, see DECLARE_COMPONENT_PICKER_STRUCT_OPS.
+        auto GetElement = [&oArrayHelper]( int32 nElement ) -> FComponentPicker&
+        {
+            return *reinterpret_cast<FComponentPicker*>( oArrayHelper.GetRawPtr( nElement ) );
+        };
+
+        // Only the components the menu listed as checked can have been unchecked, the empty and invalid elements
+        // were not listed and stay as they are.
+        TSet<const UActorComponent*> oPresentComponents;
+
+        for( int32 nElement = oArrayHelper.Num( ) - 1; nElement >= 0; --nElement )
+        {
+            FComponentPicker& rElement = GetElement( nElement );
+            const UActorComponent* pComponent = rElement.GetComponent( );
+
+            if( pComponent == nullptr ||
+                oPickedComponents.Contains( pComponent ) ||
+                !IsComponentPickerValid( rElement ) )
+            {
+                oPresentComponents.Add( pComponent );
+            }
+            else if( bFixedSize )
+            {
+                rElement = oEmptyValue;
+            }
+            else
+            {
+                oArrayHelper.RemoveValues( nElement );
+            }
+        }
+
+        // The new picks are appended after the existing elements. EditFixedSize arrays are never resized, the picks
+        // are written in their empty elements instead, and the ones that don't fit are dropped.
+        int32 nEmptyElement = 0;
+
+        for( UActorComponent* pComponent : rComponents )
+        {
+            if( !oPickedComponents.Contains( pComponent ) || oPresentComponents.Contains( pComponent ) )
+            {
+                continue;
+            }
+
+            oPresentComponents.Add( pComponent );
+
+            if( !bFixedSize )
+            {
+                GetElement( oArrayHelper.AddValue( ) ) = FComponentPicker( pComponent );
+                continue;
+            }
+
+            while( nEmptyElement < oArrayHelper.Num( ) && !GetElement( nEmptyElement ).HasSameTarget( oEmptyValue ) )
+            {
+                ++nEmptyElement;
+            }
+
+            if( nEmptyElement < oArrayHelper.Num( ) )
+            {
+                GetElement( nEmptyElement++ ) = FComponentPicker( pComponent );
+            }
+            else
+            {
+                ++nNumDroppedPicks;
+            }
+        }
+    }
+
+    if( nNumDroppedPicks > 0 )
+    {
+        UE_LOG( LogComponentPicker,
+                Warning,
+                TEXT( "%s has a fixed size, %d picked components did not fit in its empty elements." ),
+                *m_pPropertyHandle->GetPropertyDisplayName( ).ToString( ),
+                nNumDroppedPicks );
+    }
+
+    m_pPropertyHandle->NotifyPostChange( EPropertyChangeType::ValueSet );
+    m_pPropertyHandle->NotifyFinishedChangingProperties( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::GetArrayValues( TArray<UActorComponent*>& rOutComponents ) const
+{
+    const FArrayProperty* pArrayProperty =
+        m_pPropertyHandle.IsValid( ) ? CastField<FArrayProperty>( m_pPropertyHandle->GetProperty( ) ) : nullptr;
+
+    if( pArrayProperty == nullptr )
+    {
+        return;
+    }
+
+    TArray<void*> oRawData;
+    m_pPropertyHandle->AccessRawData( oRawData );
+
+    const int32 nFirstValue = oRawData.IndexOfByPredicate( []( const void* pRawPtr ) { return pRawPtr != nullptr; } );
+
+    if( nFirstValue == INDEX_NONE )
+    {
+        return;
+    }
+
+    FScriptArrayHelper oArrayHelper( pArrayProperty, oRawData[nFirstValue] );
+
+    if( oArrayHelper.Num( ) == 0 )
+    {
+        return;
+    }
+
+    rOutComponents.SetNumZeroed( oArrayHelper.Num( ) );
+    FComponentPicker::GetComponents(
+        MakeArrayView( reinterpret_cast<const FComponentPicker*>( oArrayHelper.GetRawPtr( 0 ) ), oArrayHelper.Num( ) ),
+        rOutComponents );
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 FPropertyAccess::Result FComponentPickerCustomization::GetValue( FComponentPicker& rOutValue ) const
 {
+    COMPONENT_PICKER_SCOPE( GetValue );
+
     // Potentially accessing the value while garbage collecting or saving the package could trigger a crash.
     // so we fail to get the value when that is occurring.
     if( GIsSavingPackage || IsGarbageCollecting( ) )
@@ -360,44 +629,58 @@ FPropertyAccess::Result FComponentPickerCustomization::GetValue( FComponentPicke
         return FPropertyAccess::Fail;
     }
 
-    FPropertyAccess::Result eResult = FPropertyAccess::Fail;
+    if( !m_pPropertyHandle.IsValid( ) || !m_pPropertyHandle->IsValidHandle( ) )
+    {
+        return FPropertyAccess::Fail;
+    }
+
+    TArray<void*> oRawData;
+    m_pPropertyHandle->AccessRawData( oRawData );
+
+    return ReadRawValues( oRawData, rOutValue );
+}
 
-    if( m_pPropertyHandle.IsValid( ) && m_pPropertyHandle->IsValidHandle( ) )
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FPropertyAccess::Result FComponentPickerCustomization::ReadRawValues( TArrayView<void* const> oRawData,
+                                                                       FComponentPicker& rOutValue )
+{
+    const int32 nFirstValue = oRawData.IndexOfByPredicate( []( const void* pRawPtr ) { return pRawPtr != nullptr; } );
+
+    if( nFirstValue == INDEX_NONE )
     {
-        TArray<void*> oRawData;
-        m_pPropertyHandle->AccessRawData( oRawData );
-        const UActorComponent* pCurrentComponent = nullptr;
+        return FPropertyAccess::Fail;
+    }
+
+    const FComponentPicker& rFirstValue = *reinterpret_cast<const FComponentPicker*>( oRawData[nFirstValue] );
+    rOutValue = rFirstValue;
+
+    // Compare every other value with the first one without resolving the weak pointers. Large selections are split
+    // in chunks compared in parallel.
+    const int32 nNumValues = oRawData.Num( ) - nFirstValue - 1;
+    const int32 nNumChunks = FMath::DivideAndRoundUp( nNumValues, GetValueChunkSize );
+    FThreadSafeBool bMultipleValues = false;
 
-        for( const void* pRawPtr : oRawData )
+    ParallelFor(
+        nNumChunks,
+        [&oRawData, &rFirstValue, &bMultipleValues, nFirstValue, nNumValues]( int32 nChunk )
         {
-            if( pRawPtr )
+            const int32 nStart = nFirstValue + 1 + nChunk * GetValueChunkSize;
+            const int32 nEnd = FMath::Min( nStart + GetValueChunkSize, nFirstValue + 1 + nNumValues );
+
+            for( int32 nIndex = nStart; nIndex < nEnd && !bMultipleValues; ++nIndex )
             {
-                const FComponentPicker& rThisReference = *reinterpret_cast<const FComponentPicker*>( pRawPtr );
+                const void* pRawPtr = oRawData[nIndex];
 
-                if( eResult == FPropertyAccess::Success )
+                if( pRawPtr == nullptr ||
+                    !reinterpret_cast<const FComponentPicker*>( pRawPtr )->HasSameTarget( rFirstValue ) )
                 {
-                    if( rThisReference.GetComponent( ) != pCurrentComponent )
-                    {
-                        eResult = FPropertyAccess::MultipleValues;
-                        break;
-                    }
+                    bMultipleValues = true;
                 }
-                else
-                {
-                    rOutValue = rThisReference;
-                    pCurrentComponent = rOutValue.GetComponent( );
-                    eResult = FPropertyAccess::Success;
-                }
-            }
-            else if( eResult == FPropertyAccess::Success )
-            {
-                eResult = FPropertyAccess::MultipleValues;
-                break;
             }
-        }
-    }
+        },
+        nNumChunks < 2 );
 
-    return eResult;
+    return bMultipleValues ? FPropertyAccess::MultipleValues : FPropertyAccess::Success;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -460,6 +743,50 @@ bool FComponentPickerCustomization::IsComponentPickerValid( const FComponentPick
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void FComponentPickerCustomization::OnPropertyValueChanged( )
 {
+    COMPONENT_PICKER_SCOPE( OnPropertyValueChanged );
+
+    // The notification is registered on the header and on every child handle, and bulk operations (paste to many,
+    // undo, reimport) fire it many times per frame. All of them are handled by a single pass on the next tick.
+    if( m_bRevalidationPending )
+    {
+        ++m_nCoalescedNotifications;
+        FComponentPickerStats::Increment( FComponentPickerStats::ECounter::AvoidedRevalidations );
+        return;
+    }
+
+    if( GEditor == nullptr )
+    {
+        RevalidateValue( );
+        return;
+    }
+
+    m_bRevalidationPending = true;
+    GEditor->GetTimerManager( )->SetTimerForNextTick(
+        FTimerDelegate::CreateSP( this, &FComponentPickerCustomization::RevalidateValue ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::RevalidateValue( )
+{
+    if( m_nCoalescedNotifications > 0 )
+    {
+        UE_LOG( LogComponentPicker,
+                Verbose,
+                TEXT( "Coalesced %d change notifications of %s into one revalidation." ),
+                m_nCoalescedNotifications,
+                m_pPropertyHandle.IsValid( ) ? *m_pPropertyHandle->GetPropertyDisplayName( ).ToString( ) : TEXT( "" ) );
+    }
+
+    m_bRevalidationPending = false;
+    m_nCoalescedNotifications = 0;
+
+    FComponentPickerStats::Increment( FComponentPickerStats::ECounter::Revalidations );
+
+    if( !m_pPropertyHandle.IsValid( ) || !m_pPropertyHandle->IsValidHandle( ) )
+    {
+        return;
+    }
+
     m_pCachedComponent.Reset( );
     m_pCachedFirstOuterActor = GetFirstOuterActor( );
 
@@ -470,6 +797,7 @@ void FComponentPickerCustomization::OnPropertyValueChanged( )
     {
         m_pCachedComponent = oTmpComponentReference.GetComponent( );
 
+        // Values that don't pass the filters anymore are cleared, once for all the coalesced notifications.
         if( !IsComponentPickerValid( oTmpComponentReference ) )
         {
             m_pCachedComponent.Reset( );
@@ -480,6 +808,93 @@ void FComponentPickerCustomization::OnPropertyValueChanged( )
             }
         }
     }
+
+    UpdateDisplayCache( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::UpdateDisplayCache( )
+{
+    const UActorComponent* pComponent = m_pCachedComponent.Get( );
+    const AActor* pOwner = pComponent ? pComponent->GetOwner( ) : nullptr;
+
+    m_pCachedActorIcon =
+        FSlateIconFinder::FindIconBrushForClass( pOwner ? pOwner->GetClass( ) : AActor::StaticClass( ) );
+    m_strCachedActorName =
+        pOwner ? FText::AsCultureInvariant( pOwner->GetActorLabel( ) ) : LOCTEXT( "NoActor", "None" );
+
+    m_pCachedComponentIcon = FSlateIconFinder::FindIconBrushForClass(
+        pComponent ? pComponent->GetClass( ) : UActorComponent::StaticClass( ) );
+    m_strCachedComponentName = LOCTEXT( "NoComponent", "None" );
+
+    if( m_eCachedPropertyAccess == FPropertyAccess::Success )
+    {
+        if( pComponent )
+        {
+            const FName strComponentName = FComponentEditorUtils::FindVariableNameGivenComponentInstance( pComponent );
+
+            const bool bIsArrayVariable = !strComponentName.IsNone( ) &&
+                pOwner != nullptr &&
+                FindFProperty<FArrayProperty>( pOwner->GetClass( ), strComponentName );
+
+            if( !strComponentName.IsNone( ) && !bIsArrayVariable )
+            {
+                m_strCachedComponentName = FText::FromName( strComponentName );
+            }
+            else
+            {
+                m_strCachedComponentName = FText::AsCultureInvariant( pComponent->GetName( ) );
+            }
+        }
+    }
+    else if( m_eCachedPropertyAccess == FPropertyAccess::MultipleValues )
+    {
+        m_strCachedComponentName = LOCTEXT( "MultipleValues", "Multiple Values" );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::OnObjectRenamed( UObject* pObject, UObject* pOldOuter, FName strOldName )
+{
+    UpdateDisplayCacheIfDisplayed( pObject );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::OnObjectPropertyChanged( UObject* pObject,
+                                                             FPropertyChangedEvent& rPropertyChangedEvent )
+{
+    UpdateDisplayCacheIfDisplayed( pObject );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::UpdateDisplayCacheIfDisplayed( const UObject* pObject )
+{
+    // Renaming the component or relabelling its owner changes the displayed names.
+    const UActorComponent* pComponent = m_pCachedComponent.Get( );
+
+    if( pComponent && pObject && ( pObject == pComponent || pObject == pComponent->GetOwner( ) ) )
+    {
+        UpdateDisplayCache( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap )
+{
+    // The weak pointer of a replaced component is stale, the value is read again.
+    const UActorComponent* pComponent = m_pCachedComponent.Get( );
+
+    if( pComponent &&
+        ( rReplacementMap.Contains( pComponent ) || rReplacementMap.Contains( pComponent->GetOwner( ) ) ) )
+    {
+        OnPropertyValueChanged( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::OnActorLabelChanged( AActor* pActor )
+{
+    UpdateDisplayCacheIfDisplayed( pActor );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -514,70 +929,25 @@ bool FComponentPickerCustomization::CanEditChildren( ) const
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 const FSlateBrush* FComponentPickerCustomization::GetActorIcon( ) const
 {
-    if( const UActorComponent* pComponent = m_pCachedComponent.Get( ) )
-    {
-        if( AActor* pOwner = pComponent->GetOwner( ) )
-        {
-            return FSlateIconFinder::FindIconBrushForClass( pOwner->GetClass( ) );
-        }
-    }
-
-    return FSlateIconFinder::FindIconBrushForClass( AActor::StaticClass( ) );;
+    return m_pCachedActorIcon;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 FText FComponentPickerCustomization::OnGetActorName( ) const
 {
-    if( const UActorComponent* pComponent = m_pCachedComponent.Get( ) )
-    {
-        if( AActor* pOwner = pComponent->GetOwner( ) )
-        {
-            return FText::AsCultureInvariant( pOwner->GetActorLabel( ) );
-        }
-    }
-
-    return LOCTEXT( "NoActor", "None" );
+    return m_strCachedActorName;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 const FSlateBrush* FComponentPickerCustomization::GetComponentIcon( ) const
 {
-    if( const UActorComponent* pActorComponent = m_pCachedComponent.Get( ) )
-    {
-        return FSlateIconFinder::FindIconBrushForClass( pActorComponent->GetClass( ) );
-    }
-
-    return FSlateIconFinder::FindIconBrushForClass( UActorComponent::StaticClass( ) );
+    return m_pCachedComponentIcon;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 FText FComponentPickerCustomization::OnGetComponentName( ) const
 {
-    if( m_eCachedPropertyAccess == FPropertyAccess::Success )
-    {
-        if( const UActorComponent* pActorComponent = m_pCachedComponent.Get( ) )
-        {
-            const FName strComponentName =
-                FComponentEditorUtils::FindVariableNameGivenComponentInstance( pActorComponent );
-
-            const bool bIsArrayVariable = !strComponentName.IsNone( ) &&
-                pActorComponent->GetOwner( ) != nullptr &&
-                FindFProperty<FArrayProperty>( pActorComponent->GetOwner( )->GetClass( ), strComponentName );
-
-            if( !strComponentName.IsNone( ) && !bIsArrayVariable )
-            {
-                return FText::FromName( strComponentName );
-            }
-
-            return FText::AsCultureInvariant( pActorComponent->GetName( ) );
-        }
-    }
-    else if( m_eCachedPropertyAccess == FPropertyAccess::MultipleValues )
-    {
-        return LOCTEXT( "MultipleValues", "Multiple Values" );
-    }
-
-    return LOCTEXT( "NoComponent", "None" );
+    return m_strCachedComponentName;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -600,9 +970,20 @@ TSharedRef<SWidget> FComponentPickerCustomization::OnGetMenuContent( )
 
     return SNew( SComponentPicker )
         .pInitialComponent( pInitialComponent )
+        .pOwnerActor( m_pCachedFirstOuterActor.Get( ) )
         .bAllowClear( m_bAllowClear )
+        .bAllowAnyActor( m_bAllowAnyActor )
+        .bAllowUnloadedActors( m_bAllowUnloadedActors )
         .oActorFilter( FOnShouldFilterActor::CreateSP( this, &FComponentPickerCustomization::IsAllowedActor ) )
         .oComponentFilter( FOnShouldFilterComponent::CreateSP( this, &FComponentPickerCustomization::IsFilteredComponent ) )
+        .oUnloadedActorClassFilter(
+            FOnShouldFilterClass::CreateSP( this, &FComponentPickerCustomization::IsFilteredActorClass ) )
+        .oUnloadedComponentClassFilter(
+            FOnShouldFilterClass::CreateSP( this, &FComponentPickerCustomization::IsFilteredComponentClass ) )
+        .pCandidateSet( m_bAllowUnloadedActors
+                            ? nullptr
+                            : FComponentPickerCandidateCache::Get( ).Find(
+                                m_pCachedFirstOuterActor.Get( ), m_bAllowAnyActor, m_pClassFilters ) )
         .oOnSet( FOnComponentPicked::CreateSP( this, &FComponentPickerCustomization::OnComponentSelected ) )
         .oOnClose( FSimpleDelegate::CreateSP( this, &FComponentPickerCustomization::CloseComboButton ) );
 }
@@ -613,7 +994,63 @@ void FComponentPickerCustomization::OnMenuOpenChanged( bool bOpen )
     if( !bOpen )
     {
         m_pComponentComboButton->SetMenuContent( SNullWidget::NullWidget );
+
+        // The candidates outlive the menu, they are only built again if the level changed while it was open.
+        if( !m_bAllowUnloadedActors )
+        {
+            FComponentPickerCandidateCache::Get( ).Prewarm(
+                m_pCachedFirstOuterActor.Get( ), m_bAllowAnyActor, m_pClassFilters );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::OpenMultiPickMenu( )
+{
+    if( !m_pPropertyHandle->IsValidHandle( ) )
+    {
+        return;
     }
+
+    TSharedPtr<SWindow> pParentWindow = FSlateApplication::Get( ).GetActiveTopLevelWindow( );
+
+    if( !pParentWindow.IsValid( ) )
+    {
+        return;
+    }
+
+    // The outer actor is read again, the button outlives the selection of the details panel it was made for.
+    m_pCachedFirstOuterActor = GetFirstOuterActor( );
+
+    CloseMultiPickMenu( );
+
+    FSlateApplication& rSlateApplication = FSlateApplication::Get( );
+    m_pMultiPickMenu = rSlateApplication.PushMenu( pParentWindow.ToSharedRef( ),
+                                                   FWidgetPath( ),
+                                                   OnGetMultiPickMenuContent( ),
+                                                   rSlateApplication.GetCursorPos( ),
+                                                   FPopupTransitionEffect( FPopupTransitionEffect::ContextMenu ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<SWidget> FComponentPickerCustomization::OnGetMultiPickMenuContent( )
+{
+    TArray<UActorComponent*> oInitialComponents;
+    GetArrayValues( oInitialComponents );
+
+    // Same filters as the picker of a single element.
+    return SNew( SComponentPicker )
+        .pOwnerActor( m_pCachedFirstOuterActor.Get( ) )
+        .bAllowAnyActor( m_bAllowAnyActor )
+        .bMultiSelect( true )
+        .oInitialComponents( oInitialComponents )
+        .oActorFilter( FOnShouldFilterActor::CreateSP( this, &FComponentPickerCustomization::IsAllowedActor ) )
+        .oComponentFilter(
+            FOnShouldFilterComponent::CreateSP( this, &FComponentPickerCustomization::IsFilteredComponent ) )
+        .pCandidateSet( FComponentPickerCandidateCache::Get( ).Find(
+            m_pCachedFirstOuterActor.Get( ), m_bAllowAnyActor, m_pClassFilters ) )
+        .oOnSetMultiple( FOnComponentsPicked::CreateSP( this, &FComponentPickerCustomization::SetArrayValues ) )
+        .oOnClose( FSimpleDelegate::CreateSP( this, &FComponentPickerCustomization::CloseMultiPickMenu ) );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -625,60 +1062,97 @@ bool FComponentPickerCustomization::IsAllowedActor( const AActor* const pActor )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool FComponentPickerCustomization::IsFilteredComponent( const UActorComponent* const pComponent ) const
 {
-    const USceneComponent* pSceneComp = Cast<USceneComponent>( pComponent );
-    const AActor* pOuterActor = m_pCachedFirstOuterActor.Get( );
+    COMPONENT_PICKER_SCOPE( IsFilteredComponent );
 
-    return pComponent->GetOwner( ) &&
-        ( IsAllowedActor( pComponent->GetOwner( ) ) ) &&
-        ( !m_bAllowAnyActor || ( pOuterActor != nullptr &&
-                                 pComponent->GetOwner( )->GetLevel( ) == pOuterActor->GetLevel( ) ) ) &&
-        FComponentEditorUtils::CanEditComponentInstance( pComponent, pSceneComp, false ) &&
-        IsFilteredObject( pComponent, m_oAllowedComponentClassFilters, m_oDisallowedComponentClassFilters ) &&
-        IsFilteredObject( pComponent->GetOwner( ), m_oAllowedActorClassFilters, m_oDisallowedActorClassFilters );
+    return ValidateComponent( pComponent, m_pCachedFirstOuterActor.Get( ), m_bAllowAnyActor, *m_pClassFilters ) ==
+        EComponentPickerValidation::Valid;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FComponentPickerCustomization::IsFilteredObject( const UObject* const pObject,
-                                                      const TArray<const UClass*>& rAllowedFilters,
-                                                      const TArray<const UClass*>& rDisallowedFilters )
+FComponentPickerValidationInput FComponentPickerCustomization::GatherValidationInput(
+    const UActorComponent* pComponent,
+    const AActor* pOuterActor,
+    bool bAllowAnyActor )
 {
-    bool bAllowedToSetBasedOnFilter = true;
+    check( IsInGameThread( ) );
+
+    const AActor* pOwner = pComponent->GetOwner( );
 
-    const UClass* pObjectClass = pObject->GetClass( );
+    FComponentPickerValidationInput oInput;
+    oInput.pComponentClass = pComponent->GetClass( );
+    oInput.pOwnerClass = pOwner ? pOwner->GetClass( ) : nullptr;
+    oInput.bOwnedByOuterActor = pOwner != nullptr && pOwner == pOuterActor;
+    oInput.bInOuterActorLevel =
+        pOwner != nullptr && pOuterActor != nullptr && pOwner->GetLevel( ) == pOuterActor->GetLevel( );
 
-    if( rAllowedFilters.Num( ) > 0 )
+    // The most expensive read, skipped when the owner already fails the rules.
+    if( bAllowAnyActor ? oInput.bInOuterActorLevel : oInput.bOwnedByOuterActor )
     {
-        bAllowedToSetBasedOnFilter = false;
+        oInput.bEditable =
+            FComponentEditorUtils::CanEditComponentInstance( pComponent, Cast<USceneComponent>( pComponent ), false );
+    }
 
-        for( const UClass* pAllowedClass : rAllowedFilters )
-        {
-            const bool bAllowedClassIsInterface = pAllowedClass->HasAnyClassFlags( CLASS_Interface );
+    return oInput;
+}
 
-            if( pObjectClass->IsChildOf( pAllowedClass ) ||
-                ( bAllowedClassIsInterface && pObjectClass->ImplementsInterface( pAllowedClass ) ) )
-            {
-                bAllowedToSetBasedOnFilter = true;
-                break;
-            }
-        }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EComponentPickerValidation FComponentPickerCustomization::ValidateComponent(
+    const FComponentPickerValidationInput& rInput,
+    bool bAllowAnyActor,
+    const FComponentPickerClassFilters& rClassFilters )
+{
+    if( rInput.pOwnerClass == nullptr || ( !bAllowAnyActor && !rInput.bOwnedByOuterActor ) )
+    {
+        return EComponentPickerValidation::OtherActor;
     }
 
-    if( rDisallowedFilters.Num( ) > 0 && bAllowedToSetBasedOnFilter )
+    if( bAllowAnyActor && !rInput.bInOuterActorLevel )
     {
-        for( const UClass* pDisallowedClass : rDisallowedFilters )
-        {
-            const bool bDisallowedClassIsInterface = pDisallowedClass->HasAnyClassFlags( CLASS_Interface );
+        return EComponentPickerValidation::OtherLevel;
+    }
 
-            if( pObjectClass->IsChildOf( pDisallowedClass ) ||
-                ( bDisallowedClassIsInterface && pObjectClass->ImplementsInterface( pDisallowedClass ) ) )
-            {
-                bAllowedToSetBasedOnFilter = false;
-                break;
-            }
-        }
+    if( !rInput.bEditable )
+    {
+        return EComponentPickerValidation::NotEditable;
+    }
+
+    if( !IsFilteredClass( rInput.pComponentClass, rClassFilters.oComponentFilter ) ||
+        !IsFilteredClass( rInput.pOwnerClass, rClassFilters.oActorFilter ) )
+    {
+        return EComponentPickerValidation::FilteredOut;
     }
 
-    return bAllowedToSetBasedOnFilter;
+    return EComponentPickerValidation::Valid;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EComponentPickerValidation FComponentPickerCustomization::ValidateComponent(
+    const UActorComponent* pComponent,
+    const AActor* pOuterActor,
+    bool bAllowAnyActor,
+    const FComponentPickerClassFilters& rClassFilters )
+{
+    return ValidateComponent(
+        GatherValidationInput( pComponent, pOuterActor, bAllowAnyActor ), bAllowAnyActor, rClassFilters );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerCustomization::IsFilteredClass( const UClass* const pClass,
+                                                     const FComponentPickerClassFilter& rClassFilter )
+{
+    return rClassFilter.IsFilteredClass( pClass );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerCustomization::IsFilteredActorClass( const UClass* const pClass ) const
+{
+    return IsFilteredClass( pClass, m_pClassFilters->oActorFilter );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerCustomization::IsFilteredComponentClass( const UClass* const pClass ) const
+{
+    return IsFilteredClass( pClass, m_pClassFilters->oComponentFilter );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -695,4 +1169,13 @@ void FComponentPickerCustomization::CloseComboButton( )
     m_pComponentComboButton->SetIsOpen( false );
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerCustomization::CloseMultiPickMenu( )
+{
+    if( TSharedPtr<IMenu> pMenu = m_pMultiPickMenu.Pin( ) )
+    {
+        pMenu->Dismiss( );
+    }
+}
+
 #undef LOCTEXT_NAMESPACE
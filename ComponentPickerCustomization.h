@@ -2,17 +2,120 @@
 
 #pragma once
 
+#include "ComponentPickerClassFilter.h"
+
+#include "PropertyEditorModule.h"
+
+class IMenu;
 class SComboButton;
 class SWidget;
 struct FSlateBrush;
 struct FComponentPicker;
 
+// Result of FComponentPickerCustomization::ValidateComponent.
+enum class EComponentPickerValidation : uint8
+{
+    Valid,
+
+    // The component has no owner, or without AllowAnyActor, is not owned by the actor holding the property
+    OtherActor,
+
+    // With AllowAnyActor, the owner of the component is not in the level of the actor holding the property
+    OtherLevel,
+
+    // The component can't be edited on this instance (e.g. it was created by a construction script)
+    NotEditable,
+
+    // The component or its owner does not pass the AllowedClasses/DisallowedClasses metadata
+    FilteredOut,
+};
+
+// What the validation rules read from the component and the actor holding the property. It is gathered on the game
+// thread, the rules themselves only read it and the class filters.
+struct FComponentPickerValidationInput
+{
+    // Classes of the component and of its owner, null when the component has no owner
+    const UClass* pComponentClass = nullptr;
+    const UClass* pOwnerClass = nullptr;
+
+    // Whether the owner is the actor holding the property, or is in its level
+    bool bOwnedByOuterActor = false;
+    bool bInOuterActorLevel = false;
+
+    // Whether the component can be edited on this instance
+    bool bEditable = false;
+};
+
 class FComponentPickerCustomization : public IPropertyTypeCustomization
 {
 public:
+    virtual ~FComponentPickerCustomization( );
+
     // Makes a new instance of this customization for a specific detail view requesting it.
     static TSharedRef<IPropertyTypeCustomization> MakeInstance( );
 
+    // Number of change notifications, over all instances, that did not cause a revalidation of their own.
+    static uint64 GetNumAvoidedRevalidations( );
+
+    // Metadata of the FComponentPicker properties.
+    static const FName NAME_AllowAnyActor;
+    static const FName NAME_AllowUnloadedActors;
+    static const FName NAME_AllowedClasses;
+    static const FName NAME_DisallowedClasses;
+
+    // Read what the validation rules need from the component and the actor holding the property. Game thread only,
+    // e.g. FComponentEditorUtils::CanEditComponentInstance walks the construction script of the owner.
+    static FComponentPickerValidationInput GatherValidationInput( const UActorComponent* pComponent,
+                                                                  const AActor* pOuterActor,
+                                                                  bool bAllowAnyActor );
+
+    // The rules deciding whether a component can be picked by a property held by another actor. Only reads rInput and
+    // the class filters, so it can be called from worker threads.
+    static EComponentPickerValidation ValidateComponent( const FComponentPickerValidationInput& rInput,
+                                                         bool bAllowAnyActor,
+                                                         const FComponentPickerClassFilters& rClassFilters );
+
+    // Both of the above. Game thread only.
+    static EComponentPickerValidation ValidateComponent( const UActorComponent* pComponent,
+                                                         const AActor* pOuterActor,
+                                                         bool bAllowAnyActor,
+                                                         const FComponentPickerClassFilters& rClassFilters );
+
+    // Register the customization of a struct declared with COMPONENT_PICKER_BODY, see MakeTypedInstance.
+    template<typename TPickerStruct>
+    static void RegisterTypedCustomization( FPropertyEditorModule& rPropertyModule )
+    {
+        AddTypedPickerClass( TPickerStruct::StaticStruct( ), TPickerStruct::FComponentType::StaticClass( ) );
+        rPropertyModule.RegisterCustomPropertyTypeLayout(
+            TPickerStruct::StaticStruct( )->GetFName( ),
+            FOnGetPropertyTypeCustomizationInstance::CreateStatic( &MakeTypedInstance<TPickerStruct> ) );
+    }
+
+    // Component class of a struct registered with RegisterTypedCustomization, or of its parent struct. Null for
+    // FComponentPicker, whose class filters come from the AllowedClasses metadata.
+    static const UClass* FindTypedPickerClass( const UStruct* pStruct );
+
+    // Add the button picking every element at once to the rows of the arrays of FComponentPicker (or of typed
+    // pickers), empty arrays included.
+    static void RegisterArrayRowExtension( FPropertyEditorModule& rPropertyModule );
+    static void UnregisterArrayRowExtension( FPropertyEditorModule& rPropertyModule );
+
+    // The write of SetValue: copies rValue in the raw data of every edited value, skipping the null entries.
+    static void WriteRawValues( TArrayView<void* const> oRawData, const FComponentPicker& rValue );
+
+    // The read of GetValue: the first edited value, and whether all the others target the same component.
+    static FPropertyAccess::Result ReadRawValues( TArrayView<void* const> oRawData, FComponentPicker& rOutValue );
+
+    // Makes a new instance for a struct declared with COMPONENT_PICKER_BODY. Its component class is used as the
+    // allowed class instead of the AllowedClasses metadata.
+    template<typename TPickerStruct>
+    static TSharedRef<IPropertyTypeCustomization> MakeTypedInstance( )
+    {
+        TSharedRef<FComponentPickerCustomization> pCustomization = MakeShareable( new FComponentPickerCustomization );
+        pCustomization->m_pRequiredComponentClass = TPickerStruct::FComponentType::StaticClass( );
+        return pCustomization;
+    }
+
     // START IPropertyTypeCustomization interface.
     virtual void CustomizeHeader( TSharedRef<class IPropertyHandle> pInPropertyHandle,
                                   class FDetailWidgetRow& rHeaderRow,
@@ -24,7 +127,18 @@ public:
     // END IPropertyTypeCustomization interface.
 
 private:
-    // From the property metadata, build the list of allowed and disallowed classes.
+    static void AddTypedPickerClass( const UStruct* pStruct, const UClass* pComponentClass );
+
+    // Adds the multi-pick button to the row of rArgs.PropertyHandle when it is an array of pickers.
+    static void OnGenerateArrayRowExtension( const FOnGenerateGlobalRowExtensionArgs& rArgs,
+                                             TArray<FPropertyRowExtensionButton>& rOutExtensions );
+
+    // Makes the instance behind the multi-pick button of an array row. Its property handle is the array, the
+    // filters come from the array metadata and from the class of pElementStruct when it is a typed picker.
+    static TSharedRef<FComponentPickerCustomization> MakeArrayInstance( TSharedRef<IPropertyHandle> pArrayHandle,
+                                                                        const UStruct* pElementStruct );
+
+    // From the property metadata, get the filters of allowed and disallowed classes.
     void BuildClassFilters( );
 
     // Build the combobox widget.
@@ -37,15 +151,40 @@ private:
     // Will set the underlying property handle if there is one.
     void SetValue( const FComponentPicker& Value );
 
+    // Apply the components checked in the multi-pick menu to the edited array, in a single transaction and a single
+    // write of the raw data of every edited object. The elements stay in place: the unchecked components are removed
+    // (cleared on EditFixedSize arrays), the new ones are appended (written in the empty elements on EditFixedSize
+    // arrays). Empty elements and the ones the menu could not list, e.g. invalid ones, are kept as they are.
+    void SetArrayValues( const TArray<UActorComponent*>& rComponents );
+
+    // Get the components of the edited array, from the first edited object.
+    void GetArrayValues( TArray<UActorComponent*>& rOutComponents ) const;
+
     // Get the value referenced by this widget.
     FPropertyAccess::Result GetValue( FComponentPicker& rOutValue ) const;
 
     // Is the Value valid.
     bool IsComponentPickerValid( const FComponentPicker& rValue ) const;
 
-    // Callback when the property value changed.
+    // Callback when the property value changed, schedules a revalidation on the next tick.
     void OnPropertyValueChanged( );
 
+    // Read the value again, clear it if it is not valid anymore and update the displayed names and status icon.
+    void RevalidateValue( );
+
+    // Compute the names and icons displayed in the combo button from the cached component.
+    void UpdateDisplayCache( );
+
+    // Callbacks used to refresh the displayed names when the picked component is renamed or replaced. They are
+    // sent after the change, unlike OnObjectModified.
+    void OnObjectRenamed( UObject* pObject, UObject* pOldOuter, FName strOldName );
+    void OnObjectPropertyChanged( UObject* pObject, FPropertyChangedEvent& rPropertyChangedEvent );
+    void OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap );
+    void OnActorLabelChanged( AActor* pActor );
+
+    // Refresh the display cache if pObject is the picked component or its owner.
+    void UpdateDisplayCacheIfDisplayed( const UObject* pObject );
+
 private:
     // Return 0 if we have multiple values to edit.
     // Return 1 if we display the widget normally.
@@ -67,33 +206,42 @@ private:
     // ensure any settings the user set are saved.
     void OnMenuOpenChanged( bool bOpen );
 
+    // Open the menu picking every element of the array at once, under the cursor.
+    void OpenMultiPickMenu( );
+    TSharedRef<SWidget> OnGetMultiPickMenuContent( );
+
     // Returns whether the actor/component should be filtered out from selection.
     bool IsAllowedActor( const AActor* const pActor ) const;
     bool IsFilteredComponent( const UActorComponent* const pComponent ) const;
-    static bool IsFilteredObject( const UObject* const pObject,
-                                  const TArray<const UClass*>& rAllowedFilters,
-                                  const TArray<const UClass*>& rDisallowedFilters );
+    static bool IsFilteredClass( const UClass* const pClass, const FComponentPickerClassFilter& rClassFilter );
+
+    // Returns whether the components of unloaded actors pass the filters, from the class of the actor descriptor and
+    // of the component template.
+    bool IsFilteredActorClass( const UClass* const pClass ) const;
+    bool IsFilteredComponentClass( const UClass* const pClass ) const;
 
     // Delegate for handling selection in the scene outliner.
     void OnComponentSelected( UActorComponent* pInComponent );
 
     // Closes the combo button.
     void CloseComboButton( );
+    void CloseMultiPickMenu( );
 
 private:
-    // The property handle we are customizing
+    // The property handle we are customizing, the array itself for the instances made by MakeArrayInstance
     TSharedPtr<IPropertyHandle> m_pPropertyHandle;
 
     // Main combo button
     TSharedPtr<SComboButton> m_pComponentComboButton;
 
-    // Classes that can be used with this property
-    TArray<const UClass*> m_oAllowedActorClassFilters;
-    TArray<const UClass*> m_oAllowedComponentClassFilters;
+    // Menu opened by the multi-pick button of the array row
+    TWeakPtr<IMenu> m_pMultiPickMenu;
 
-    // Classes that can NOT be used with this property
-    TArray<const UClass*> m_oDisallowedActorClassFilters;
-    TArray<const UClass*> m_oDisallowedComponentClassFilters;
+    // Classes that can and can NOT be used with this property, shared with the properties using the same metadata
+    TSharedPtr<const FComponentPickerClassFilters> m_pClassFilters;
+
+    // Component class fixed at compile time by typed pickers, null for FComponentPicker
+    const UClass* m_pRequiredComponentClass = nullptr;
 
     // Whether the asset can be 'None' in this case
     bool m_bAllowClear;
@@ -101,8 +249,26 @@ private:
     // Can the actor be different/selected.
     bool m_bAllowAnyActor;
 
+    // Are the World Partition actors that are not loaded listed too (requires AllowAnyActor).
+    bool m_bAllowUnloadedActors = false;
+
     // Cached values
     TWeakObjectPtr<AActor> m_pCachedFirstOuterActor;
     TWeakObjectPtr<UActorComponent> m_pCachedComponent;
     FPropertyAccess::Result m_eCachedPropertyAccess;
+
+    // Cached display values, so the Slate attributes don't compute them on every paint
+    FText m_strCachedActorName;
+    FText m_strCachedComponentName;
+    const FSlateBrush* m_pCachedActorIcon = nullptr;
+    const FSlateBrush* m_pCachedComponentIcon = nullptr;
+
+    // Whether a revalidation is scheduled, and how many notifications it handles
+    bool m_bRevalidationPending = false;
+    int32 m_nCoalescedNotifications = 0;
+
+    FDelegateHandle m_hObjectRenamed;
+    FDelegateHandle m_hObjectPropertyChanged;
+    FDelegateHandle m_hObjectsReplaced;
+    FDelegateHandle m_hActorLabelChanged;
 };
@@ -0,0 +1,745 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerIndex.h"
+#include "ComponentPickerIndexCache.h"
+
+#include "Editor.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/SCS_Node.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/World.h"
+#include "Misc/CoreDelegates.h"
+#include "TimerManager.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/UObjectHash.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionActorDesc.h"
+#include "WorldPartition/WorldPartitionHelpers.h"
+
+static TUniquePtr<FComponentPickerIndex> GComponentPickerIndex;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GatherClassComponents( const UClass* pActorClass, TArray<TPair<FName, const UClass*>>& rOutComponents )
+{
+    // Native components, including the ones inherited from the parent classes.
+    if( const AActor* pDefaultActor = pActorClass->GetDefaultObject<AActor>( ) )
+    {
+        for( const UActorComponent* pComponent : pDefaultActor->GetComponents( ) )
+        {
+            if( pComponent )
+            {
+                rOutComponents.Emplace( pComponent->GetFName( ), pComponent->GetClass( ) );
+            }
+        }
+    }
+
+    // Components added by the construction scripts of the Blueprint class and its parents. The instances are named
+    // after their variable.
+    for( const UBlueprintGeneratedClass* pClass = Cast<UBlueprintGeneratedClass>( pActorClass );
+         pClass;
+         pClass = Cast<UBlueprintGeneratedClass>( pClass->GetSuperClass( ) ) )
+    {
+        if( pClass->SimpleConstructionScript == nullptr )
+        {
+            continue;
+        }
+
+        for( const USCS_Node* pNode : pClass->SimpleConstructionScript->GetAllNodes( ) )
+        {
+            if( pNode && pNode->ComponentTemplate )
+            {
+                rOutComponents.Emplace( pNode->GetVariableName( ), pNode->ComponentTemplate->GetClass( ) );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerIndex& FComponentPickerIndex::Get( )
+{
+    if( !GComponentPickerIndex.IsValid( ) )
+    {
+        GComponentPickerIndex = MakeUnique<FComponentPickerIndex>( );
+
+        // Unregister from the engine delegates before they are destroyed.
+        FCoreDelegates::OnPreExit.AddLambda( []( )
+        {
+            GComponentPickerIndex.Reset( );
+        } );
+    }
+
+    return *GComponentPickerIndex;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerIndex::FComponentPickerIndex( )
+{
+    if( GEngine )
+    {
+        m_hLevelActorAdded = GEngine->OnLevelActorAdded( ).AddRaw( this, &FComponentPickerIndex::OnLevelActorAdded );
+        m_hLevelActorDeleted =
+            GEngine->OnLevelActorDeleted( ).AddRaw( this, &FComponentPickerIndex::OnLevelActorDeleted );
+        m_hLevelActorListChanged = GEngine->OnLevelActorListChanged( ).AddRaw( this, &FComponentPickerIndex::Reset );
+    }
+
+    m_hObjectModified = FCoreUObjectDelegates::OnObjectModified.AddRaw( this, &FComponentPickerIndex::OnObjectModified );
+    m_hObjectsReplaced =
+        FCoreUObjectDelegates::OnObjectsReplaced.AddRaw( this, &FComponentPickerIndex::OnObjectsReplaced );
+    m_hObjectRenamed = FCoreUObjectDelegates::OnObjectRenamed.AddRaw( this, &FComponentPickerIndex::OnObjectRenamed );
+    m_hActorLabelChanged =
+        FCoreDelegates::OnActorLabelChanged.AddRaw( this, &FComponentPickerIndex::OnActorLabelChanged );
+    m_hLevelAdded = FWorldDelegates::LevelAddedToWorld.AddRaw( this, &FComponentPickerIndex::OnLevelAdded );
+    m_hLevelRemoved = FWorldDelegates::LevelRemovedFromWorld.AddRaw( this, &FComponentPickerIndex::OnLevelRemoved );
+    m_hWorldCleanup = FWorldDelegates::OnWorldCleanup.AddRaw( this, &FComponentPickerIndex::OnWorldCleanup );
+    m_hPackageSaved = UPackage::PackageSavedWithContextEvent.AddRaw( this, &FComponentPickerIndex::OnPackageSaved );
+    m_hPostGarbageCollect =
+        FCoreUObjectDelegates::GetPostGarbageCollect( ).AddRaw( this, &FComponentPickerIndex::OnPostGarbageCollect );
+
+    // Components added by construction scripts or editor tools don't always modify their owner.
+    GUObjectArray.AddUObjectCreateListener( this );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerIndex::~FComponentPickerIndex( )
+{
+    if( GEngine )
+    {
+        GEngine->OnLevelActorAdded( ).Remove( m_hLevelActorAdded );
+        GEngine->OnLevelActorDeleted( ).Remove( m_hLevelActorDeleted );
+        GEngine->OnLevelActorListChanged( ).Remove( m_hLevelActorListChanged );
+    }
+
+    FCoreUObjectDelegates::OnObjectModified.Remove( m_hObjectModified );
+    FCoreUObjectDelegates::OnObjectsReplaced.Remove( m_hObjectsReplaced );
+    FCoreUObjectDelegates::OnObjectRenamed.Remove( m_hObjectRenamed );
+    FCoreDelegates::OnActorLabelChanged.Remove( m_hActorLabelChanged );
+    FWorldDelegates::LevelAddedToWorld.Remove( m_hLevelAdded );
+    FWorldDelegates::LevelRemovedFromWorld.Remove( m_hLevelRemoved );
+    FWorldDelegates::OnWorldCleanup.Remove( m_hWorldCleanup );
+    UPackage::PackageSavedWithContextEvent.Remove( m_hPackageSaved );
+    FCoreUObjectDelegates::GetPostGarbageCollect( ).Remove( m_hPostGarbageCollect );
+    GUObjectArray.RemoveUObjectCreateListener( this );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::GetComponents( const AActor* pActor, TArray<UActorComponent*>& rOutComponents )
+{
+    if( pActor == nullptr || pActor->GetLevel( ) == nullptr )
+    {
+        return;
+    }
+
+    FLevelEntry& rLevelEntry = FindOrBuildLevel( pActor->GetLevel( ) );
+    RefreshDirtyActors( rLevelEntry );
+
+    if( const TArray<TWeakObjectPtr<UActorComponent>>* pComponents = rLevelEntry.oActors.Find( pActor ) )
+    {
+        for( const TWeakObjectPtr<UActorComponent>& pComponent : *pComponents )
+        {
+            if( UActorComponent* pResolvedComponent = pComponent.Get( ) )
+            {
+                rOutComponents.Add( pResolvedComponent );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::GetComponents( const ULevel* pLevel, TArray<UActorComponent*>& rOutComponents )
+{
+    if( pLevel == nullptr )
+    {
+        return;
+    }
+
+    FLevelEntry& rLevelEntry = FindOrBuildLevel( pLevel );
+    RefreshDirtyActors( rLevelEntry );
+
+    for( const auto& rActorPair : rLevelEntry.oActors )
+    {
+        for( const TWeakObjectPtr<UActorComponent>& pComponent : rActorPair.Value )
+        {
+            if( UActorComponent* pResolvedComponent = pComponent.Get( ) )
+            {
+                rOutComponents.Add( pResolvedComponent );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::GetUnloadedComponents(
+    FComponentPickerUnloadedWalk& rWalk,
+    double fEndTime,
+    TFunctionRef<bool( const UClass* pActorClass )> oActorClassFilter,
+    TFunctionRef<bool( const UClass* pComponentClass )> oComponentClassFilter,
+    TArray<FComponentPickerUnloadedComponent>& rOutComponents )
+{
+    UWorld* pWorld = rWalk.pWorld.Get( );
+    UWorldPartition* pWorldPartition = pWorld ? pWorld->GetWorldPartition( ) : nullptr;
+
+    if( pWorldPartition == nullptr || rWalk.bDone )
+    {
+        rWalk.bDone = true;
+        return;
+    }
+
+    // The descriptors are listed once, each call resumes from where the previous one stopped without walking the
+    // visited ones again.
+    if( !rWalk.bActorDescsGathered )
+    {
+        rWalk.bActorDescsGathered = true;
+
+        FWorldPartitionHelpers::ForEachActorDesc( pWorldPartition,
+                                                  AActor::StaticClass( ),
+                                                  [&rWalk]( const FWorldPartitionActorDesc* pActorDesc )
+        {
+            rWalk.oActorDescGuids.Add( pActorDesc->GetGuid( ) );
+            return true;
+        } );
+    }
+
+    while( rWalk.nNextActorDesc < rWalk.oActorDescGuids.Num( ) )
+    {
+        // Descriptors removed since they were listed are skipped, loaded actors are listed from their level.
+        const FWorldPartitionActorDesc* pActorDesc =
+            pWorldPartition->GetActorDesc( rWalk.oActorDescGuids[rWalk.nNextActorDesc++] );
+        const UClass* pNativeClass =
+            pActorDesc == nullptr || pActorDesc->IsLoaded( ) ? nullptr : pActorDesc->GetActorNativeClass( );
+
+        if( pNativeClass && oActorClassFilter( pNativeClass ) )
+        {
+            const FString strBaseClass = pActorDesc->GetBaseClass( ).ToString( );
+            const FString strClassPath = strBaseClass.IsEmpty( ) || strBaseClass == TEXT( "None" )
+                ? pNativeClass->GetPathName( )
+                : strBaseClass;
+
+            TArray<TPair<FName, const UClass*>>* pComponents = rWalk.oClassComponents.Find( strClassPath );
+
+            if( pComponents == nullptr )
+            {
+                pComponents = &rWalk.oClassComponents.Add( strClassPath );
+
+                const UClass* pActorClass = strClassPath == pNativeClass->GetPathName( )
+                    ? pNativeClass
+                    : FindObject<UClass>( nullptr, *strClassPath );
+
+                // A Blueprint class is never loaded here, its package would load every asset it references.
+                if( pActorClass == nullptr )
+                {
+                    pActorClass = pNativeClass;
+                }
+
+                if( pActorClass == pNativeClass || oActorClassFilter( pActorClass ) )
+                {
+                    GatherClassComponents( pActorClass, *pComponents );
+                }
+            }
+
+            const FName strActorLabel = pActorDesc->GetActorLabel( );
+
+            for( const TPair<FName, const UClass*>& rComponent : *pComponents )
+            {
+                if( oComponentClassFilter( rComponent.Value ) )
+                {
+                    FComponentPickerUnloadedComponent& rOutComponent = rOutComponents.AddDefaulted_GetRef( );
+                    rOutComponent.oActorGuid = pActorDesc->GetGuid( );
+                    rOutComponent.strActorLabel =
+                        strActorLabel.IsNone( ) ? pActorDesc->GetActorName( ).ToString( ) : strActorLabel.ToString( );
+                    rOutComponent.strComponentName = rComponent.Key;
+                    rOutComponent.pComponentClass = rComponent.Value;
+                }
+            }
+        }
+
+        if( FPlatformTime::Seconds( ) >= fEndTime )
+        {
+            break;
+        }
+    }
+
+    rWalk.bDone = rWalk.nNextActorDesc >= rWalk.oActorDescGuids.Num( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64 FComponentPickerIndex::GetGeneration( const ULevel* pLevel )
+{
+    if( pLevel == nullptr )
+    {
+        return 0;
+    }
+
+    FLevelEntry& rLevelEntry = FindOrBuildLevel( pLevel );
+    RefreshDirtyActors( rLevelEntry );
+
+    return rLevelEntry.nGeneration;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+AActor* FComponentPickerIndex::LoadActor( UWorld* pWorld, const FGuid& rActorGuid )
+{
+    UWorldPartition* pWorldPartition = pWorld ? pWorld->GetWorldPartition( ) : nullptr;
+
+    if( pWorldPartition == nullptr )
+    {
+        return nullptr;
+    }
+
+    // The reference loads the actor and keeps it loaded.
+    FWorldPartitionReference oReference( pWorldPartition, rActorGuid );
+    AActor* pActor = oReference.IsValid( ) ? oReference->GetActor( ) : nullptr;
+
+    if( pActor )
+    {
+        m_oLoadedActors.FindOrAdd( pWorld ).Add( MoveTemp( oReference ) );
+    }
+
+    return pActor;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::BuildLevel( const ULevel* pLevel, const FComponentPickerIndexCache& rCache )
+{
+    m_oLevels.Remove( pLevel );
+
+    FLevelEntry& rLevelEntry = m_oLevels.Add( pLevel );
+    rLevelEntry.nGeneration = ++m_nLastGeneration;
+    BuildLevelFromCache( pLevel, rCache, rLevelEntry );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::Reset( )
+{
+    m_oLevels.Reset( );
+    m_oCreatedComponents.Reset( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::NotifyUObjectCreated( const UObjectBase* pObject, int32 nIndex )
+{
+    // Components loaded on other threads come with their level, which is indexed again when it is added.
+    if( !IsInGameThread( ) || m_oLevels.Num( ) == 0 )
+    {
+        return;
+    }
+
+    UObject* pCreatedObject = static_cast<UObject*>( const_cast<UObjectBase*>( pObject ) );
+    UActorComponent* pComponent = Cast<UActorComponent>( pCreatedObject );
+
+    if( pComponent == nullptr || pComponent->HasAnyFlags( RF_ClassDefaultObject | RF_ArchetypeObject ) )
+    {
+        return;
+    }
+
+    // Only the actors of the indexed levels matter, which skips PIE, preview worlds and Blueprint compile templates.
+    const AActor* pOuterActor = Cast<AActor>( pComponent->GetOuter( ) );
+    const ULevel* pOuterLevel = pOuterActor ? Cast<ULevel>( pOuterActor->GetOuter( ) ) : nullptr;
+
+    if( pOuterLevel == nullptr || !m_oLevels.Contains( pOuterLevel ) )
+    {
+        return;
+    }
+
+    // The owners are flagged on the next tick rather than on the next query, so the queue only holds one frame.
+    const bool bFlushPending = m_oCreatedComponents.Num( ) > 0;
+    m_oCreatedComponents.Add( pComponent );
+
+    if( !bFlushPending && GEditor )
+    {
+        GEditor->GetTimerManager( )->SetTimerForNextTick( FTimerDelegate::CreateLambda( []( )
+        {
+            if( GComponentPickerIndex.IsValid( ) )
+            {
+                GComponentPickerIndex->FlushCreatedComponents( );
+            }
+        } ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnUObjectArrayShutdown( )
+{
+    GUObjectArray.RemoveUObjectCreateListener( this );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerIndex::FLevelEntry& FComponentPickerIndex::FindOrBuildLevel( const ULevel* pLevel )
+{
+    if( FLevelEntry* pLevelEntry = m_oLevels.Find( pLevel ) )
+    {
+        return *pLevelEntry;
+    }
+
+    FLevelEntry& rLevelEntry = m_oLevels.Add( pLevel );
+    rLevelEntry.nGeneration = ++m_nLastGeneration;
+
+    if( const TSharedPtr<const FComponentPickerIndexCache> pCache = FComponentPickerIndexCache::Open( pLevel ) )
+    {
+        BuildLevelFromCache( pLevel, *pCache, rLevelEntry );
+        return rLevelEntry;
+    }
+
+    // Only the actors are registered here, their components are gathered on the first query.
+    for( AActor* pActor : pLevel->Actors )
+    {
+        if( IsValid( pActor ) )
+        {
+            rLevelEntry.oActors.Add( pActor );
+            rLevelEntry.oDirtyActors.Add( pActor );
+        }
+    }
+
+    // So that the next editor session can skip the traversal. Writing now would slow down the first picker.
+    rLevelEntry.bWriteCache = true;
+
+    return rLevelEntry;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::BuildLevelFromCache( const ULevel* pLevel,
+                                                 const FComponentPickerIndexCache& rCache,
+                                                 FLevelEntry& rLevelEntry )
+{
+    // The level is the list of actors, the file only tells their components. Actors of World Partition cells that
+    // are not loaded are in the file but not in the level.
+    for( AActor* pActor : pLevel->Actors )
+    {
+        if( !IsValid( pActor ) )
+        {
+            continue;
+        }
+
+        TArray<TWeakObjectPtr<UActorComponent>>& rComponents = rLevelEntry.oActors.Add( pActor );
+        const int32 nActor = rCache.FindActor( pActor );
+
+        // Actors that are not in the file, e.g. spawned or loaded after the level, or that were saved since.
+        if( nActor == INDEX_NONE || !rCache.IsActorUpToDate( nActor, pActor ) )
+        {
+            rLevelEntry.oDirtyActors.Add( pActor );
+            continue;
+        }
+
+        int32 nFirstComponent = 0;
+        int32 nNumComponents = 0;
+        rCache.GetActorComponents( nActor, nFirstComponent, nNumComponents );
+
+        // A Blueprint class that gained or lost a component since the file was written leaves the saved hashes of
+        // the level unchanged. Actors with components the file can't hold (not outered to them) are refreshed too.
+        if( nNumComponents != pActor->GetComponents( ).Num( ) )
+        {
+            rLevelEntry.oDirtyActors.Add( pActor );
+            continue;
+        }
+
+        rComponents.Reserve( nNumComponents );
+
+        for( int32 nComponent = nFirstComponent; nComponent < nFirstComponent + nNumComponents; ++nComponent )
+        {
+            const FName strComponentName = rCache.GetComponentName( nComponent );
+            UActorComponent* pComponent =
+                strComponentName.IsNone( ) ? nullptr : FindObjectFast<UActorComponent>( pActor, strComponentName );
+
+            // Components created by the construction script may not be named as they were when the file was written.
+            if( !IsValid( pComponent ) )
+            {
+                rLevelEntry.oDirtyActors.Add( pActor );
+                break;
+            }
+
+            rComponents.Add( pComponent );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::RefreshDirtyActors( FLevelEntry& rLevelEntry )
+{
+    FlushCreatedComponents( );
+
+    // Most actors are flagged because they were modified, only a different component list changes the generation.
+    bool bChanged = false;
+    TArray<TWeakObjectPtr<UActorComponent>> oPreviousComponents;
+
+    for( const TWeakObjectPtr<AActor>& pDirtyActor : rLevelEntry.oDirtyActors )
+    {
+        AActor* pActor = pDirtyActor.Get( );
+
+        if( !IsValid( pActor ) )
+        {
+            continue;
+        }
+
+        TArray<TWeakObjectPtr<UActorComponent>>& rComponents = rLevelEntry.oActors.FindOrAdd( pActor );
+        oPreviousComponents = MoveTemp( rComponents );
+        rComponents.Reset( );
+
+        for( UActorComponent* pComponent : pActor->GetComponents( ) )
+        {
+            if( IsValid( pComponent ) )
+            {
+                rComponents.Add( pComponent );
+            }
+        }
+
+        bChanged |= rComponents != oPreviousComponents;
+    }
+
+    rLevelEntry.oDirtyActors.Reset( );
+
+    // Drop the actors that were garbage collected without being deleted from the level. Deleted actors are removed
+    // by OnLevelActorDeleted, so the level is only walked after a collection.
+    if( rLevelEntry.bPruneCollectedActors )
+    {
+        rLevelEntry.bPruneCollectedActors = false;
+
+        for( auto It = rLevelEntry.oActors.CreateIterator( ); It; ++It )
+        {
+            if( It.Key( ).ResolveObjectPtr( ) == nullptr )
+            {
+                It.RemoveCurrent( );
+                bChanged = true;
+            }
+        }
+    }
+
+    if( bChanged )
+    {
+        rLevelEntry.nGeneration = ++m_nLastGeneration;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::MarkActorDirty( AActor* pActor )
+{
+    // Levels that were never queried will be built from scratch anyway.
+    if( FLevelEntry* pLevelEntry = pActor ? m_oLevels.Find( pActor->GetLevel( ) ) : nullptr )
+    {
+        pLevelEntry->oDirtyActors.Add( pActor );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::FlushCreatedComponents( )
+{
+    for( const TWeakObjectPtr<UActorComponent>& pComponent : m_oCreatedComponents )
+    {
+        if( UActorComponent* pResolvedComponent = pComponent.Get( ) )
+        {
+            MarkActorDirty( pResolvedComponent->GetOwner( ) );
+        }
+    }
+
+    m_oCreatedComponents.Reset( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::BumpGeneration( const AActor* pActor )
+{
+    if( FLevelEntry* pLevelEntry = pActor ? m_oLevels.Find( pActor->GetLevel( ) ) : nullptr )
+    {
+        pLevelEntry->nGeneration = ++m_nLastGeneration;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnLevelActorAdded( AActor* pActor )
+{
+    MarkActorDirty( pActor );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnLevelActorDeleted( AActor* pActor )
+{
+    if( FLevelEntry* pLevelEntry = pActor ? m_oLevels.Find( pActor->GetLevel( ) ) : nullptr )
+    {
+        pLevelEntry->oActors.Remove( pActor );
+        pLevelEntry->oDirtyActors.Remove( pActor );
+        pLevelEntry->nGeneration = ++m_nLastGeneration;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnObjectModified( UObject* pObject )
+{
+    // Adding or removing components modifies the owner, components are also modified when they get renamed.
+    if( AActor* pActor = Cast<AActor>( pObject ) )
+    {
+        MarkActorDirty( pActor );
+    }
+    else if( UActorComponent* pComponent = Cast<UActorComponent>( pObject ) )
+    {
+        MarkActorDirty( pComponent->GetOwner( ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap )
+{
+    // Blueprint reinstancing replaces actors and components in place.
+    for( const TPair<UObject*, UObject*>& rReplacement : rReplacementMap )
+    {
+        OnObjectModified( rReplacement.Value );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnObjectRenamed( UObject* pObject, UObject* pOldOuter, FName strOldName )
+{
+    // Pickers list the components by name.
+    if( const UActorComponent* pComponent = Cast<UActorComponent>( pObject ) )
+    {
+        BumpGeneration( pComponent->GetOwner( ) );
+    }
+    else
+    {
+        BumpGeneration( Cast<AActor>( pObject ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnActorLabelChanged( AActor* pActor )
+{
+    BumpGeneration( pActor );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnLevelAdded( ULevel* pLevel, UWorld* pWorld )
+{
+    // The level will be rebuilt the next time it is queried.
+    m_oLevels.Remove( pLevel );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnLevelRemoved( ULevel* pLevel, UWorld* pWorld )
+{
+    // A null level means that all the levels of the world were removed.
+    if( pLevel )
+    {
+        RemoveLevel( pLevel );
+    }
+    else
+    {
+        OnWorldCleanup( pWorld, true, true );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnWorldCleanup( UWorld* pWorld, bool bSessionEnded, bool bCleanupResources )
+{
+    // The references must be released before World Partition is uninitialized.
+    m_oLoadedActors.Remove( pWorld );
+
+    for( auto It = m_oLevels.CreateIterator( ); It; ++It )
+    {
+        const ULevel* pLevel = It.Key( ).ResolveObjectPtr( );
+
+        if( pLevel == nullptr || pLevel->GetWorld( ) == pWorld )
+        {
+            if( pLevel && It.Value( ).bWriteCache )
+            {
+                FComponentPickerIndexCache::Write( pLevel );
+            }
+
+            It.RemoveCurrent( );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnPostGarbageCollect( )
+{
+    for( TPair<TObjectKey<ULevel>, FLevelEntry>& rLevelEntry : m_oLevels )
+    {
+        rLevelEntry.Value.bPruneCollectedActors = true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::OnPackageSaved( const FString& rFilename,
+                                            UPackage* pPackage,
+                                            FObjectPostSaveContext oContext )
+{
+    // The saved hash of the package changed, the previous cache file no longer matches it.
+    if( oContext.IsProceduralSave( ) )
+    {
+        return;
+    }
+
+    const bool bWritePending = m_oLevelsToWrite.Num( ) > 0;
+
+    if( const UWorld* pWorld = UWorld::FindWorldInPackage( pPackage ) )
+    {
+        m_oLevelsToWrite.Add( pWorld->PersistentLevel );
+    }
+    else
+    {
+        // External actor packages (One File Per Actor) change the saved hash of their actor, not of the level.
+        ForEachObjectWithPackage( pPackage, [this]( UObject* pObject )
+        {
+            const AActor* pActor = Cast<AActor>( pObject );
+            const ULevel* pLevel = pActor ? pActor->GetLevel( ) : nullptr;
+
+            if( pLevel && m_oLevels.Contains( pLevel ) )
+            {
+                m_oLevelsToWrite.Add( pLevel );
+            }
+
+            return pActor == nullptr;
+        } );
+    }
+
+    // Saving a level saves all of its actor packages too, the file is written once they are all saved.
+    if( !bWritePending && m_oLevelsToWrite.Num( ) > 0 )
+    {
+        if( GEditor )
+        {
+            GEditor->GetTimerManager( )->SetTimerForNextTick( FTimerDelegate::CreateLambda( []( )
+            {
+                if( GComponentPickerIndex.IsValid( ) )
+                {
+                    GComponentPickerIndex->WritePendingCaches( );
+                }
+            } ) );
+        }
+        else
+        {
+            WritePendingCaches( );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::WritePendingCaches( )
+{
+    for( const TWeakObjectPtr<const ULevel>& pWeakLevel : m_oLevelsToWrite )
+    {
+        if( const ULevel* pLevel = pWeakLevel.Get( ) )
+        {
+            if( FComponentPickerIndexCache::Write( pLevel ) )
+            {
+                if( FLevelEntry* pLevelEntry = m_oLevels.Find( pLevel ) )
+                {
+                    pLevelEntry->bWriteCache = false;
+                }
+            }
+        }
+    }
+
+    m_oLevelsToWrite.Reset( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndex::RemoveLevel( const ULevel* pLevel )
+{
+    const FLevelEntry* pLevelEntry = m_oLevels.Find( pLevel );
+
+    if( pLevelEntry && pLevelEntry->bWriteCache )
+    {
+        FComponentPickerIndexCache::Write( pLevel );
+    }
+
+    m_oLevels.Remove( pLevel );
+}
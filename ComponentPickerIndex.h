@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "UObject/ObjectKey.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/ObjectSaveContext.h"
+#include "WorldPartition/WorldPartitionHandle.h"
+
+class AActor;
+class FComponentPickerIndexCache;
+class UActorComponent;
+class ULevel;
+class UPackage;
+class UObject;
+class UWorld;
+
+// A component of a World Partition actor that is not loaded, described by the actor descriptor of its owner and the
+// component layout of the owner class.
+struct FComponentPickerUnloadedComponent
+{
+    FGuid oActorGuid;
+    FString strActorLabel;
+    FName strComponentName;
+    const UClass* pComponentClass = nullptr;
+};
+
+// Progress of GetUnloadedComponents over the actor descriptors of a world, so that the walk can be spread over frames.
+struct FComponentPickerUnloadedWalk
+{
+    TWeakObjectPtr<UWorld> pWorld;
+
+    // Actor descriptors of the world, gathered by the first call, and whether they were.
+    TArray<FGuid> oActorDescGuids;
+    bool bActorDescsGathered = false;
+
+    // Number of actor descriptors visited so far, and whether all of them were.
+    int32 nNextActorDesc = 0;
+    bool bDone = false;
+
+    // Component layout of every actor class met so far, keyed by class path.
+    TMap<FString, TArray<TPair<FName, const UClass*>>> oClassComponents;
+};
+
+// Per-level list of the components that can be shown by SComponentPicker. The index is built lazily the first time a
+// level is queried and is then kept up to date from actor spawn/destroy, component creation, object modification,
+// garbage collection and level add/remove events, so opening a picker no longer walks every actor of the world.
+// Saved levels are read back from FComponentPickerIndexCache, so the components are found by name instead of walking
+// the actors after a restart. The cache files are written when the levels, or their external actor packages, are
+// saved, and when a level indexed without one is closed.
+class FComponentPickerIndex : public FUObjectArray::FUObjectCreateListener
+{
+public:
+    // Get the global index. The engine delegates used to keep it up to date are registered on first use.
+    static FComponentPickerIndex& Get( );
+
+    FComponentPickerIndex( );
+    ~FComponentPickerIndex( );
+
+    // Gather the components owned by a single actor.
+    void GetComponents( const AActor* pActor, TArray<UActorComponent*>& rOutComponents );
+
+    // Gather all the components owned by the actors of a level.
+    void GetComponents( const ULevel* pLevel, TArray<UActorComponent*>& rOutComponents );
+
+    // Gather the components of the World Partition actors of the world that are not loaded, without loading them.
+    // The actor descriptors are filtered on their native class first, then the components are read from the default
+    // object and construction script of the actor class and filtered on their class. Nothing is loaded: the actor
+    // class is found from the base class path of the descriptor, and a Blueprint class that is not loaded only lists
+    // the components of its native class. The walk resumes from rWalk and stops at fEndTime
+    // (FPlatformTime::Seconds), rWalk.bDone is set once every descriptor was visited.
+    void GetUnloadedComponents( FComponentPickerUnloadedWalk& rWalk,
+                                double fEndTime,
+                                TFunctionRef<bool( const UClass* pActorClass )> oActorClassFilter,
+                                TFunctionRef<bool( const UClass* pComponentClass )> oComponentClassFilter,
+                                TArray<FComponentPickerUnloadedComponent>& rOutComponents );
+
+    // Generation of a level, changed whenever components are added to or removed from it, or when a component or
+    // its owner is renamed. Pending changes are applied first, so a value equal to the one returned earlier means
+    // that the components listed for the level have not changed since.
+    uint64 GetGeneration( const ULevel* pLevel );
+
+    // Load a World Partition actor of the world. It is kept loaded until the world is cleaned up.
+    AActor* LoadActor( UWorld* pWorld, const FGuid& rActorGuid );
+
+    // Index a level from a cache file opened with FComponentPickerIndexCache::OpenFile, replacing its entry. Used by
+    // the benchmarks to compare it with the build from the level actors.
+    void BuildLevel( const ULevel* pLevel, const FComponentPickerIndexCache& rCache );
+
+    // Forget everything that has been indexed so far.
+    void Reset( );
+
+    // START FUObjectCreateListener interface.
+    virtual void NotifyUObjectCreated( const UObjectBase* pObject, int32 nIndex ) override;
+    virtual void OnUObjectArrayShutdown( ) override;
+    // END FUObjectCreateListener interface.
+
+private:
+    struct FLevelEntry
+    {
+        // Components of every indexed actor of the level.
+        TMap<TObjectKey<AActor>, TArray<TWeakObjectPtr<UActorComponent>>> oActors;
+
+        // Actors whose component list has to be gathered again before the next query.
+        TSet<TWeakObjectPtr<AActor>> oDirtyActors;
+
+        // See GetGeneration.
+        uint64 nGeneration = 0;
+
+        // Set by garbage collections, the actors that were collected are dropped on the next query.
+        bool bPruneCollectedActors = false;
+
+        // Set when the level was indexed without a cache file, it is written when the level is closed.
+        bool bWriteCache = false;
+    };
+
+    // Find or build the entry of a level.
+    FLevelEntry& FindOrBuildLevel( const ULevel* pLevel );
+
+    // Build the entry of a level from its cache file.
+    void BuildLevelFromCache( const ULevel* pLevel,
+                              const FComponentPickerIndexCache& rCache,
+                              FLevelEntry& rLevelEntry );
+
+    // Write the cache files of the levels whose packages were saved in the last frame.
+    void WritePendingCaches( );
+
+    // Drop the entry of a level, writing its cache file first if it has none.
+    void RemoveLevel( const ULevel* pLevel );
+
+    // Gather the components of the actor again if it was flagged as dirty.
+    void RefreshDirtyActors( FLevelEntry& rLevelEntry );
+
+    // Flag the actor so that its components are gathered again on the next query.
+    void MarkActorDirty( AActor* pActor );
+
+    // Flag the owners of the components created since the last tick or query.
+    void FlushCreatedComponents( );
+
+    // Change the generation of the level of the actor.
+    void BumpGeneration( const AActor* pActor );
+
+    // Engine callbacks.
+    void OnLevelActorAdded( AActor* pActor );
+    void OnLevelActorDeleted( AActor* pActor );
+    void OnObjectModified( UObject* pObject );
+    void OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap );
+    void OnObjectRenamed( UObject* pObject, UObject* pOldOuter, FName strOldName );
+    void OnActorLabelChanged( AActor* pActor );
+    void OnLevelAdded( ULevel* pLevel, UWorld* pWorld );
+    void OnLevelRemoved( ULevel* pLevel, UWorld* pWorld );
+    void OnWorldCleanup( UWorld* pWorld, bool bSessionEnded, bool bCleanupResources );
+    void OnPackageSaved( const FString& rFilename, UPackage* pPackage, FObjectPostSaveContext oContext );
+    void OnPostGarbageCollect( );
+
+private:
+    TMap<TObjectKey<ULevel>, FLevelEntry> m_oLevels;
+
+    // Last generation given to a level, generations are never reused.
+    uint64 m_nLastGeneration = 0;
+
+    // Components created on the game thread for the actors of the indexed levels since the last tick or query, their
+    // owner is not known yet when they are created
+    TArray<TWeakObjectPtr<UActorComponent>> m_oCreatedComponents;
+
+    // World Partition actors loaded by LoadActor
+    TMap<TObjectKey<UWorld>, TArray<FWorldPartitionReference>> m_oLoadedActors;
+
+    // Levels whose cache file is written on the next tick, a save of all the actors of a level writes it once
+    TSet<TWeakObjectPtr<const ULevel>> m_oLevelsToWrite;
+
+    FDelegateHandle m_hLevelActorAdded;
+    FDelegateHandle m_hLevelActorDeleted;
+    FDelegateHandle m_hLevelActorListChanged;
+    FDelegateHandle m_hObjectModified;
+    FDelegateHandle m_hObjectsReplaced;
+    FDelegateHandle m_hObjectRenamed;
+    FDelegateHandle m_hActorLabelChanged;
+    FDelegateHandle m_hLevelAdded;
+    FDelegateHandle m_hLevelRemoved;
+    FDelegateHandle m_hWorldCleanup;
+    FDelegateHandle m_hPackageSaved;
+    FDelegateHandle m_hPostGarbageCollect;
+};
@@ -0,0 +1,480 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerIndexCache.h"
+#include "ComponentPicker.h"
+
+#include "Async/Async.h"
+#include "Engine/Level.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "IO/IoHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/StringBuilder.h"
+#include "UObject/Package.h"
+
+static TAutoConsoleVariable<bool> CVarComponentPickerIndexCache(
+    TEXT( "ComponentPicker.IndexCache" ),
+    true,
+    TEXT( "Read and write the component picker index of saved levels from Saved/ComponentPicker/IndexCache." ) );
+
+// "CPIX"
+static constexpr uint32 ComponentPickerIndexCacheMagic = 0x58495043;
+
+// Increment when the layout changes, older files are ignored.
+static constexpr uint32 ComponentPickerIndexCacheVersion = 2;
+
+static constexpr int32 ComponentPickerHashSize = sizeof( FIoHash::ByteArray );
+
+// Serializes the cache files written on worker threads, and numbers the writes of every file so that only the last
+// one requested is done.
+static FCriticalSection GWriteLock;
+static TMap<FString, uint32> GWriteSerials;
+
+struct FComponentPickerIndexCache::FHeader
+{
+    uint32 nMagic;
+    uint32 nVersion;
+    uint8 aPackageHash[ComponentPickerHashSize];
+    int32 nNumActors;
+    int32 nNumComponents;
+    int32 nNumBuckets;
+    int32 nNumStrings;
+    int32 nStringDataLength;
+};
+
+struct FComponentPickerIndexCache::FActorRecord
+{
+    // Saved hash of the external package of the actor, zero for actors saved in the level package
+    uint8 aPackageHash[ComponentPickerHashSize];
+
+    // See HashName
+    uint32 nNameHash;
+
+    int32 nName;
+    int32 nFirstComponent;
+    int32 nNumComponents;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const UPackage* GetSavedPackage( const ULevel* pLevel )
+{
+    const UPackage* pPackage = pLevel ? pLevel->GetPackage( ) : nullptr;
+
+    // Levels that were never saved, or have unsaved changes, don't match any file. PIE levels are copies of the
+    // edited ones under another name.
+    if( pPackage == nullptr ||
+        pPackage->IsDirty( ) ||
+        pPackage->HasAnyPackageFlags( PKG_NewlyCreated | PKG_PlayInEditor ) )
+    {
+        return nullptr;
+    }
+
+    return pPackage;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GetPackageHash( const UPackage* pPackage, uint8 ( &rOutHash )[ComponentPickerHashSize] )
+{
+    FMemory::Memzero( rOutHash );
+
+    if( pPackage )
+    {
+        FMemory::Memcpy( rOutHash, pPackage->GetSavedHash( ).GetBytes( ), ComponentPickerHashSize );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32 HashName( const TCHAR* pName, int32 nNameLength )
+{
+    // FNV-1a, case insensitive as object names are.
+    uint32 nHash = 2166136261u;
+
+    for( int32 nChar = 0; nChar < nNameLength; ++nChar )
+    {
+        nHash = ( nHash ^ static_cast<uint32>( FChar::ToLower( pName[nChar] ) ) ) * 16777619u;
+    }
+
+    return nHash;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedPtr<const FComponentPickerIndexCache> FComponentPickerIndexCache::Open( const ULevel* pLevel )
+{
+    const UPackage* pPackage = GetSavedPackage( pLevel );
+
+    if( !CVarComponentPickerIndexCache.GetValueOnGameThread( ) || pPackage == nullptr )
+    {
+        return nullptr;
+    }
+
+    return OpenFileData( GetFilePath( pLevel ), pPackage );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerIndexCache::Write( const ULevel* pLevel )
+{
+    const UPackage* pPackage = GetSavedPackage( pLevel );
+
+    if( !CVarComponentPickerIndexCache.GetValueOnGameThread( ) || pPackage == nullptr )
+    {
+        return false;
+    }
+
+    TArray<uint8> oFileData = BuildFileData( pLevel, pPackage );
+    const FString strFilePath = GetFilePath( pLevel );
+    uint32 nSerial = 0;
+
+    {
+        FScopeLock oLock( &GWriteLock );
+        nSerial = ++GWriteSerials.FindOrAdd( strFilePath );
+    }
+
+    Async( EAsyncExecution::ThreadPool, [oFileData = MoveTemp( oFileData ), strFilePath, nSerial]( )
+    {
+        FScopeLock oLock( &GWriteLock );
+
+        // The level was saved again in the meantime, its newer file is written by the next task.
+        if( GWriteSerials.FindRef( strFilePath ) == nSerial )
+        {
+            SaveFileData( oFileData, strFilePath );
+        }
+    } );
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerIndexCache::WriteFile( const ULevel* pLevel, const FString& rFilePath )
+{
+    return pLevel && SaveFileData( BuildFileData( pLevel, pLevel->GetPackage( ) ), rFilePath );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedPtr<const FComponentPickerIndexCache> FComponentPickerIndexCache::OpenFile( const ULevel* pLevel,
+                                                                                 const FString& rFilePath )
+{
+    return pLevel ? OpenFileData( rFilePath, pLevel->GetPackage( ) ) : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int32 FComponentPickerIndexCache::FindActor( const AActor* pActor ) const
+{
+    if( m_pHeader->nNumBuckets == 0 )
+    {
+        return INDEX_NONE;
+    }
+
+    TStringBuilder<128> oName;
+    pActor->GetFName( ).AppendString( oName );
+
+    const uint32 nNameHash = HashName( oName.GetData( ), oName.Len( ) );
+    const uint32 nBucketMask = static_cast<uint32>( m_pHeader->nNumBuckets - 1 );
+
+    // Linear probing. The tables written by BuildFileData always have empty buckets, the probe is still bounded in
+    // case the file was damaged.
+    uint32 nBucket = nNameHash & nBucketMask;
+
+    for( int32 nProbe = 0; nProbe < m_pHeader->nNumBuckets; ++nProbe, nBucket = ( nBucket + 1 ) & nBucketMask )
+    {
+        const int32 nActor = m_pActorBuckets[nBucket];
+
+        if( nActor == INDEX_NONE )
+        {
+            return INDEX_NONE;
+        }
+
+        if( m_pActors[nActor].nNameHash == nNameHash &&
+            IsStringEqual( m_pActors[nActor].nName, oName.GetData( ), oName.Len( ) ) )
+        {
+            return nActor;
+        }
+    }
+
+    return INDEX_NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerIndexCache::IsActorUpToDate( int32 nActor, const AActor* pActor ) const
+{
+    uint8 aPackageHash[ComponentPickerHashSize];
+    GetPackageHash( pActor->GetExternalPackage( ), aPackageHash );
+
+    return FMemory::Memcmp( m_pActors[nActor].aPackageHash, aPackageHash, ComponentPickerHashSize ) == 0 &&
+        ( pActor->GetExternalPackage( ) == nullptr || !pActor->GetExternalPackage( )->IsDirty( ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerIndexCache::GetActorComponents( int32 nActor,
+                                                     int32& rOutFirstComponent,
+                                                     int32& rOutNumComponents ) const
+{
+    rOutFirstComponent = m_pActors[nActor].nFirstComponent;
+    rOutNumComponents = m_pActors[nActor].nNumComponents;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FName FComponentPickerIndexCache::GetComponentName( int32 nComponent ) const
+{
+    const int32 nString = m_pComponentNames[nComponent];
+    const int32 nStart = m_pStringOffsets[nString];
+    const FUTF16ToTCHAR oConverted( m_pStringData + nStart, m_pStringOffsets[nString + 1] - nStart );
+
+    // A name that was never created can't be the name of a loaded object, there is no need to add it.
+    return FName( oConverted.Length( ), oConverted.Get( ), FNAME_Find );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FString FComponentPickerIndexCache::GetFilePath( const ULevel* pLevel )
+{
+    // One file per level package, e.g. Saved/ComponentPicker/IndexCache/Game/Maps/MyMap.cpix
+    return FPaths::ProjectSavedDir( ) / TEXT( "ComponentPicker/IndexCache" ) /
+        pLevel->GetPackage( )->GetName( ) + TEXT( ".cpix" );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TArray<uint8> FComponentPickerIndexCache::BuildFileData( const ULevel* pLevel, const UPackage* pPackage )
+{
+    FHeader oHeader;
+    FMemory::Memzero( oHeader );
+    oHeader.nMagic = ComponentPickerIndexCacheMagic;
+    oHeader.nVersion = ComponentPickerIndexCacheVersion;
+    GetPackageHash( pPackage, oHeader.aPackageHash );
+
+    TArray<FActorRecord> oActors;
+    TArray<int32> oComponentNames;
+    TArray<int32> oStringOffsets;
+    TArray<UTF16CHAR> oStringData;
+    TMap<FString, int32> oStringIndices;
+
+    auto oAddString = [&]( FStringView oString )
+    {
+        const FString strString( oString );
+
+        if( const int32* pIndex = oStringIndices.Find( strString ) )
+        {
+            return *pIndex;
+        }
+
+        const FTCHARToUTF16 oConverted( oString.GetData( ), oString.Len( ) );
+        oStringOffsets.Add( oStringData.Num( ) );
+        oStringData.Append( reinterpret_cast<const UTF16CHAR*>( oConverted.Get( ) ), oConverted.Length( ) );
+
+        return oStringIndices.Add( strString, oStringOffsets.Num( ) - 1 );
+    };
+
+    TStringBuilder<128> oName;
+
+    for( const AActor* pActor : pLevel->Actors )
+    {
+        if( !IsValid( pActor ) )
+        {
+            continue;
+        }
+
+        oName.Reset( );
+        pActor->GetFName( ).AppendString( oName );
+
+        FActorRecord& rActor = oActors.AddZeroed_GetRef( );
+        GetPackageHash( pActor->GetExternalPackage( ), rActor.aPackageHash );
+        rActor.nNameHash = HashName( oName.GetData( ), oName.Len( ) );
+        rActor.nName = oAddString( oName.ToView( ) );
+        rActor.nFirstComponent = oComponentNames.Num( );
+
+        for( const UActorComponent* pComponent : pActor->GetComponents( ) )
+        {
+            // Only the components directly outered to their owner can be found again by name.
+            if( IsValid( pComponent ) && pComponent->GetOuter( ) == pActor )
+            {
+                oName.Reset( );
+                pComponent->GetFName( ).AppendString( oName );
+                oComponentNames.Add( oAddString( oName.ToView( ) ) );
+            }
+        }
+
+        rActor.nNumComponents = oComponentNames.Num( ) - rActor.nFirstComponent;
+    }
+
+    // At most half full, so that probing stays short and always ends on an empty bucket.
+    TArray<int32> oActorBuckets;
+    oActorBuckets.Init( INDEX_NONE, oActors.Num( ) > 0 ? FMath::RoundUpToPowerOfTwo( oActors.Num( ) * 2 ) : 0 );
+
+    for( int32 nActor = 0; nActor < oActors.Num( ); ++nActor )
+    {
+        uint32 nBucket = oActors[nActor].nNameHash & static_cast<uint32>( oActorBuckets.Num( ) - 1 );
+
+        while( oActorBuckets[nBucket] != INDEX_NONE )
+        {
+            nBucket = ( nBucket + 1 ) & static_cast<uint32>( oActorBuckets.Num( ) - 1 );
+        }
+
+        oActorBuckets[nBucket] = nActor;
+    }
+
+    oHeader.nNumActors = oActors.Num( );
+    oHeader.nNumComponents = oComponentNames.Num( );
+    oHeader.nNumBuckets = oActorBuckets.Num( );
+    oHeader.nNumStrings = oStringOffsets.Num( );
+    oHeader.nStringDataLength = oStringData.Num( );
+    oStringOffsets.Add( oStringData.Num( ) );
+
+    TArray<uint8> oFileData;
+    oFileData.Append( reinterpret_cast<const uint8*>( &oHeader ), sizeof( oHeader ) );
+    oFileData.Append( reinterpret_cast<const uint8*>( oActors.GetData( ) ), oActors.Num( ) * sizeof( FActorRecord ) );
+    oFileData.Append( reinterpret_cast<const uint8*>( oComponentNames.GetData( ) ),
+                      oComponentNames.Num( ) * sizeof( int32 ) );
+    oFileData.Append( reinterpret_cast<const uint8*>( oActorBuckets.GetData( ) ),
+                      oActorBuckets.Num( ) * sizeof( int32 ) );
+    oFileData.Append( reinterpret_cast<const uint8*>( oStringOffsets.GetData( ) ),
+                      oStringOffsets.Num( ) * sizeof( int32 ) );
+    oFileData.Append( reinterpret_cast<const uint8*>( oStringData.GetData( ) ),
+                      oStringData.Num( ) * sizeof( UTF16CHAR ) );
+
+    return oFileData;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedPtr<const FComponentPickerIndexCache> FComponentPickerIndexCache::OpenFileData( const FString& rFilePath,
+                                                                                     const UPackage* pPackage )
+{
+    TSharedPtr<FComponentPickerIndexCache> pCache = MakeShareable( new FComponentPickerIndexCache );
+
+    pCache->m_pFileHandle.Reset( FPlatformFileManager::Get( ).GetPlatformFile( ).OpenMapped( *rFilePath ) );
+
+    if( !pCache->m_pFileHandle.IsValid( ) || pCache->m_pFileHandle->GetFileSize( ) < sizeof( FHeader ) )
+    {
+        return nullptr;
+    }
+
+    pCache->m_pFileRegion.Reset( pCache->m_pFileHandle->MapRegion( 0, pCache->m_pFileHandle->GetFileSize( ) ) );
+
+    if( !pCache->m_pFileRegion.IsValid( ) )
+    {
+        return nullptr;
+    }
+
+    const uint8* pData = pCache->m_pFileRegion->GetMappedPtr( );
+    const int64 nSize = pCache->m_pFileRegion->GetMappedSize( );
+    const FHeader* pHeader = reinterpret_cast<const FHeader*>( pData );
+
+    uint8 aPackageHash[ComponentPickerHashSize];
+    GetPackageHash( pPackage, aPackageHash );
+
+    if( pHeader->nMagic != ComponentPickerIndexCacheMagic ||
+        pHeader->nVersion != ComponentPickerIndexCacheVersion ||
+        FMemory::Memcmp( pHeader->aPackageHash, aPackageHash, ComponentPickerHashSize ) != 0 )
+    {
+        UE_LOG( LogComponentPicker, Verbose, TEXT( "Index cache %s is out of date." ), *rFilePath );
+        return nullptr;
+    }
+
+    const int32 nNumActors = pHeader->nNumActors;
+    const int32 nNumComponents = pHeader->nNumComponents;
+    const int32 nNumBuckets = pHeader->nNumBuckets;
+    const int32 nNumStrings = pHeader->nNumStrings;
+
+    // The bucket count is a power of two larger than the actor count, so that probing always ends.
+    bool bValid = nNumActors >= 0 &&
+        nNumComponents >= 0 &&
+        nNumStrings >= 0 &&
+        pHeader->nStringDataLength >= 0 &&
+        ( nNumActors == 0 ? nNumBuckets == 0 : nNumBuckets > nNumActors && FMath::IsPowerOfTwo( nNumBuckets ) );
+
+    const int64 nActorsOffset = sizeof( FHeader );
+    const int64 nComponentsOffset = nActorsOffset + int64( nNumActors ) * sizeof( FActorRecord );
+    const int64 nBucketsOffset = nComponentsOffset + int64( nNumComponents ) * sizeof( int32 );
+    const int64 nStringOffsetsOffset = nBucketsOffset + int64( nNumBuckets ) * sizeof( int32 );
+    const int64 nStringDataOffset = nStringOffsetsOffset + int64( nNumStrings + 1 ) * sizeof( int32 );
+    const int64 nEndOffset = nStringDataOffset + int64( pHeader->nStringDataLength ) * sizeof( UTF16CHAR );
+
+    bValid = bValid && nEndOffset == nSize;
+
+    const FActorRecord* pActors = reinterpret_cast<const FActorRecord*>( pData + nActorsOffset );
+    const int32* pComponentNames = reinterpret_cast<const int32*>( pData + nComponentsOffset );
+    const int32* pActorBuckets = reinterpret_cast<const int32*>( pData + nBucketsOffset );
+    const int32* pStringOffsets = reinterpret_cast<const int32*>( pData + nStringOffsetsOffset );
+
+    // Every index is checked once here, so that the accessors can read the records without bounds checks.
+    auto oIsValidIndex = []( int32 nIndex, int32 nNum )
+    {
+        return nIndex >= 0 && nIndex < nNum;
+    };
+
+    for( int32 nString = 0; bValid && nString < nNumStrings; ++nString )
+    {
+        bValid = pStringOffsets[nString] >= 0 && pStringOffsets[nString] <= pStringOffsets[nString + 1];
+    }
+
+    bValid = bValid && pStringOffsets[nNumStrings] == pHeader->nStringDataLength;
+
+    for( int32 nActor = 0; bValid && nActor < nNumActors; ++nActor )
+    {
+        const FActorRecord& rActor = pActors[nActor];
+
+        bValid = oIsValidIndex( rActor.nName, nNumStrings ) &&
+            rActor.nFirstComponent >= 0 &&
+            rActor.nNumComponents >= 0 &&
+            rActor.nFirstComponent <= nNumComponents - rActor.nNumComponents;
+    }
+
+    for( int32 nComponent = 0; bValid && nComponent < nNumComponents; ++nComponent )
+    {
+        bValid = oIsValidIndex( pComponentNames[nComponent], nNumStrings );
+    }
+
+    int32 nNumEmptyBuckets = 0;
+
+    for( int32 nBucket = 0; bValid && nBucket < nNumBuckets; ++nBucket )
+    {
+        bValid = pActorBuckets[nBucket] == INDEX_NONE || oIsValidIndex( pActorBuckets[nBucket], nNumActors );
+        nNumEmptyBuckets += pActorBuckets[nBucket] == INDEX_NONE ? 1 : 0;
+    }
+
+    // A table without empty bucket was not written by BuildFileData.
+    bValid = bValid && ( nNumBuckets == 0 || nNumEmptyBuckets > 0 );
+
+    if( !bValid )
+    {
+        UE_LOG( LogComponentPicker, Warning, TEXT( "Index cache %s is corrupted." ), *rFilePath );
+        return nullptr;
+    }
+
+    pCache->m_pHeader = pHeader;
+    pCache->m_pActors = pActors;
+    pCache->m_pComponentNames = pComponentNames;
+    pCache->m_pActorBuckets = pActorBuckets;
+    pCache->m_pStringOffsets = pStringOffsets;
+    pCache->m_pStringData = reinterpret_cast<const UTF16CHAR*>( pData + nStringDataOffset );
+
+    return pCache;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerIndexCache::SaveFileData( const TArray<uint8>& rFileData, const FString& rFilePath )
+{
+    // Write to a temporary file first, a mapped cache may still be open on the previous one.
+    const FString strTempFilePath = rFilePath + TEXT( ".tmp" );
+
+    if( !FFileHelper::SaveArrayToFile( rFileData, *strTempFilePath ) ||
+        !IFileManager::Get( ).Move( *rFilePath, *strTempFilePath, true, true ) )
+    {
+        UE_LOG( LogComponentPicker, Warning, TEXT( "Could not write the index cache %s." ), *rFilePath );
+        IFileManager::Get( ).Delete( *strTempFilePath );
+        return false;
+    }
+
+    UE_LOG( LogComponentPicker, Verbose, TEXT( "Wrote the index cache %s: %d bytes." ), *rFilePath, rFileData.Num( ) );
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerIndexCache::IsStringEqual( int32 nString, const TCHAR* pName, int32 nNameLength ) const
+{
+    const int32 nStart = m_pStringOffsets[nString];
+    const FUTF16ToTCHAR oConverted( m_pStringData + nStart, m_pStringOffsets[nString + 1] - nStart );
+
+    return oConverted.Length( ) == nNameLength && FCString::Strnicmp( oConverted.Get( ), pName, nNameLength ) == 0;
+}
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GenericPlatform/GenericPlatformFile.h"
+
+class AActor;
+class ULevel;
+class UPackage;
+
+// Flat file holding the actors and components of a saved level, written when the level or one of its external actor
+// packages is saved, and when a level indexed without it is closed. The file is memory mapped and read in place: it
+// is made of fixed size records, a hash table of the actor names and a string table, so opening it does not parse or
+// allocate per actor. It is only used when the saved hash of the level package (and of the external package of each
+// actor) matches the one it was written for.
+//
+// Layout: FHeader, FActorRecord[NumActors], int32 ComponentNames[NumComponents] (string indices),
+// int32 ActorBuckets[NumBuckets] (actor indices), int32 StringOffsets[NumStrings + 1] (in characters),
+// UTF16CHAR StringData[].
+class FComponentPickerIndexCache
+{
+public:
+    // Open the cache of a level. Returns null if it doesn't exist or doesn't match the saved level.
+    static TSharedPtr<const FComponentPickerIndexCache> Open( const ULevel* pLevel );
+
+    // Write the cache of a level. The actors are read right away, the file is written on a worker thread. Levels
+    // with unsaved changes and PIE levels are skipped.
+    static bool Write( const ULevel* pLevel );
+
+    // Write and open a cache file, synchronously and whether the level is saved or not. Used by the benchmarks.
+    static bool WriteFile( const ULevel* pLevel, const FString& rFilePath );
+    static TSharedPtr<const FComponentPickerIndexCache> OpenFile( const ULevel* pLevel, const FString& rFilePath );
+
+    // Find the record of an actor of the cached level. Returns INDEX_NONE if it isn't in the file.
+    int32 FindActor( const AActor* pActor ) const;
+
+    // Returns false if the external package of the actor was saved since the cache was written.
+    bool IsActorUpToDate( int32 nActor, const AActor* pActor ) const;
+
+    // Range of the components of an actor in the component records.
+    void GetActorComponents( int32 nActor, int32& rOutFirstComponent, int32& rOutNumComponents ) const;
+
+    // Name of a component of the cached level, none if no object was ever given that name in this session.
+    FName GetComponentName( int32 nComponent ) const;
+
+private:
+    struct FHeader;
+    struct FActorRecord;
+
+    FComponentPickerIndexCache( ) = default;
+
+    // Path of the cache file of a level package.
+    static FString GetFilePath( const ULevel* pLevel );
+
+    // Build the content of the cache file of a level, and map an existing file.
+    static TArray<uint8> BuildFileData( const ULevel* pLevel, const UPackage* pPackage );
+    static TSharedPtr<const FComponentPickerIndexCache> OpenFileData( const FString& rFilePath,
+                                                                      const UPackage* pPackage );
+
+    // Write the content of a cache file, replacing the previous one.
+    static bool SaveFileData( const TArray<uint8>& rFileData, const FString& rFilePath );
+
+    // Does a string of the string table equal a name, ignoring case as object names do.
+    bool IsStringEqual( int32 nString, const TCHAR* pName, int32 nNameLength ) const;
+
+private:
+    TUniquePtr<IMappedFileHandle> m_pFileHandle;
+    TUniquePtr<IMappedFileRegion> m_pFileRegion;
+
+    // Views of the mapped file
+    const FHeader* m_pHeader = nullptr;
+    const FActorRecord* m_pActors = nullptr;
+    const int32* m_pComponentNames = nullptr;
+    const int32* m_pActorBuckets = nullptr;
+    const int32* m_pStringOffsets = nullptr;
+    const UTF16CHAR* m_pStringData = nullptr;
+};
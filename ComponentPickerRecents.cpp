@@ -0,0 +1,294 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerRecents.h"
+#include "ComponentPickerIndex.h"
+
+#include "Components/ActorComponent.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Misc/ConfigCacheIni.h"
+#include "UObject/Package.h"
+
+// Section of the per-project editor settings holding the lists.
+static const TCHAR* RecentsConfigSection = TEXT( "ComponentPicker.Recents" );
+
+// Maximum number of recent components.
+static const int32 RecentsMaxRecent = 10;
+
+// Maximum number of pinned components, the oldest pins are dropped first.
+static const int32 RecentsMaxPinned = 20;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerRecents& FComponentPickerRecents::Get( )
+{
+    static FComponentPickerRecents oRecents;
+    return oRecents;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerRecents::FComponentPickerRecents( )
+{
+    Load( TEXT( "Recent" ), m_oRecent );
+    Load( TEXT( "Pinned" ), m_oPinned );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerRecents::AddRecent( const UActorComponent* pComponent )
+{
+    if( pComponent == nullptr )
+    {
+        return;
+    }
+
+    const int32 nIndex = Find( m_oRecent, pComponent );
+
+    if( nIndex == 0 )
+    {
+        return;
+    }
+
+    FEntry oEntry;
+
+    if( !MakeEntry( pComponent, oEntry ) )
+    {
+        return;
+    }
+
+    if( nIndex != INDEX_NONE )
+    {
+        m_oRecent.RemoveAt( nIndex, 1, false );
+    }
+
+    m_oRecent.Insert( MoveTemp( oEntry ), 0 );
+
+    if( m_oRecent.Num( ) > RecentsMaxRecent )
+    {
+        m_oRecent.SetNum( RecentsMaxRecent );
+    }
+
+    Save( TEXT( "Recent" ), m_oRecent );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerRecents::SetPinned( const UActorComponent* pComponent, bool bPinned )
+{
+    const int32 nIndex = Find( m_oPinned, pComponent );
+
+    if( pComponent == nullptr || bPinned == ( nIndex != INDEX_NONE ) )
+    {
+        return;
+    }
+
+    if( bPinned )
+    {
+        FEntry oEntry;
+
+        if( !MakeEntry( pComponent, oEntry ) )
+        {
+            return;
+        }
+
+        m_oPinned.Add( MoveTemp( oEntry ) );
+
+        if( m_oPinned.Num( ) > RecentsMaxPinned )
+        {
+            m_oPinned.RemoveAt( 0 );
+        }
+    }
+    else
+    {
+        m_oPinned.RemoveAt( nIndex );
+    }
+
+    Save( TEXT( "Pinned" ), m_oPinned );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerRecents::IsPinned( const UActorComponent* pComponent ) const
+{
+    return pComponent && Find( m_oPinned, pComponent ) != INDEX_NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerRecents::GetComponents( TArray<UActorComponent*>& rOutPinned,
+                                             TArray<UActorComponent*>& rOutRecent ) const
+{
+    for( const FEntry& rEntry : m_oPinned )
+    {
+        if( UActorComponent* pComponent = Resolve( rEntry ) )
+        {
+            rOutPinned.Add( pComponent );
+        }
+    }
+
+    for( const FEntry& rEntry : m_oRecent )
+    {
+        UActorComponent* pComponent = Resolve( rEntry );
+
+        if( pComponent && !rOutPinned.Contains( pComponent ) )
+        {
+            rOutRecent.Add( pComponent );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FComponentPickerRecents::MakeEntry( const UActorComponent* pComponent, FEntry& rOutEntry )
+{
+    const AActor* pOwnerActor = pComponent ? pComponent->GetOwner( ) : nullptr;
+    const ULevel* pLevel = pOwnerActor ? pOwnerActor->GetLevel( ) : nullptr;
+
+    // PIE worlds are copies of the edited ones, their paths don't exist outside of the session.
+    if( pLevel == nullptr || pLevel->GetPackage( )->HasAnyPackageFlags( PKG_PlayInEditor ) )
+    {
+        return false;
+    }
+
+    rOutEntry.strLevelPackage = pLevel->GetPackage( )->GetFName( );
+    rOutEntry.oActorGuid = pOwnerActor->GetActorGuid( );
+    rOutEntry.strComponentName = pComponent->GetFName( );
+    rOutEntry.oPath = FSoftObjectPath( pComponent );
+    rOutEntry.pComponent = const_cast<UActorComponent*>( pComponent );
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UActorComponent* FComponentPickerRecents::Resolve( const FEntry& rEntry )
+{
+    UActorComponent* pComponent = rEntry.pComponent.Get( );
+
+    if( pComponent == nullptr )
+    {
+        // A single hash lookup, the components of maps that are not loaded are simply not found. The owner may have
+        // been renamed since, and another actor given its name.
+        pComponent = Cast<UActorComponent>( rEntry.oPath.ResolveObject( ) );
+
+        if( pComponent &&
+            rEntry.oActorGuid.IsValid( ) &&
+            ( pComponent->GetOwner( ) == nullptr || pComponent->GetOwner( )->GetActorGuid( ) != rEntry.oActorGuid ) )
+        {
+            pComponent = nullptr;
+        }
+
+        if( pComponent == nullptr )
+        {
+            pComponent = ResolveIdentity( rEntry );
+        }
+
+        if( pComponent )
+        {
+            rEntry.pComponent = pComponent;
+            rEntry.oPath = FSoftObjectPath( pComponent );
+        }
+    }
+
+    return IsValid( pComponent ) ? pComponent : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UActorComponent* FComponentPickerRecents::ResolveIdentity( const FEntry& rEntry )
+{
+    if( !rEntry.oActorGuid.IsValid( ) )
+    {
+        return nullptr;
+    }
+
+    UPackage* pPackage = FindObjectFast<UPackage>( nullptr, rEntry.strLevelPackage );
+    const UWorld* pWorld = pPackage ? UWorld::FindWorldInPackage( pPackage ) : nullptr;
+    const ULevel* pLevel = pWorld ? pWorld->PersistentLevel : nullptr;
+
+    if( pLevel == nullptr )
+    {
+        return nullptr;
+    }
+
+    // The level is only walked again when its actors or their names changed.
+    const uint64 nGeneration = FComponentPickerIndex::Get( ).GetGeneration( pLevel );
+
+    if( nGeneration == rEntry.nMissedGeneration )
+    {
+        return nullptr;
+    }
+
+    for( AActor* pActor : pLevel->Actors )
+    {
+        if( pActor && pActor->GetActorGuid( ) == rEntry.oActorGuid )
+        {
+            return FindObjectFast<UActorComponent>( pActor, rEntry.strComponentName );
+        }
+    }
+
+    rEntry.nMissedGeneration = nGeneration;
+
+    return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int32 FComponentPickerRecents::Find( const TArray<FEntry>& rEntries, const UActorComponent* pComponent )
+{
+    return rEntries.IndexOfByPredicate( [pComponent]( const FEntry& rEntry )
+    {
+        return Resolve( rEntry ) == pComponent;
+    } );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerRecents::Load( const TCHAR* pKey, TArray<FEntry>& rOutEntries )
+{
+    TArray<FString> oLines;
+    GConfig->GetArray( RecentsConfigSection, pKey, oLines, GEditorPerProjectIni );
+
+    for( const FString& rLine : oLines )
+    {
+        // "<level package> <actor GUID> <component name> <path>", or only the path for the entries saved before the
+        // identity was. Object names can't contain spaces.
+        TArray<FString> oFields;
+        rLine.ParseIntoArray( oFields, TEXT( " " ) );
+
+        // Older versions saved the entries of PIE worlds too.
+        if( oFields.Num( ) == 0 || oFields.Last( ).Contains( PLAYWORLD_PACKAGE_PREFIX ) )
+        {
+            continue;
+        }
+
+        FEntry& rEntry = rOutEntries.AddDefaulted_GetRef( );
+        rEntry.oPath = FSoftObjectPath( oFields.Last( ) );
+
+        if( oFields.Num( ) == 4 )
+        {
+            rEntry.strLevelPackage = FName( *oFields[0] );
+            FGuid::Parse( oFields[1], rEntry.oActorGuid );
+            rEntry.strComponentName = FName( *oFields[2] );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerRecents::Save( const TCHAR* pKey, const TArray<FEntry>& rEntries )
+{
+    TArray<FString> oLines;
+
+    for( const FEntry& rEntry : rEntries )
+    {
+        // Components renamed since they were added are saved under their new name and path.
+        FEntry oLoadedEntry;
+        const FEntry& rSavedEntry = MakeEntry( rEntry.pComponent.Get( ), oLoadedEntry ) ? oLoadedEntry : rEntry;
+
+        if( rSavedEntry.oActorGuid.IsValid( ) )
+        {
+            oLines.Add( FString::Printf( TEXT( "%s %s %s %s" ),
+                                         *rSavedEntry.strLevelPackage.ToString( ),
+                                         *rSavedEntry.oActorGuid.ToString( ),
+                                         *rSavedEntry.strComponentName.ToString( ),
+                                         *rSavedEntry.oPath.ToString( ) ) );
+        }
+        else
+        {
+            oLines.Add( rSavedEntry.oPath.ToString( ) );
+        }
+    }
+
+    GConfig->SetArray( RecentsConfigSection, pKey, oLines, GEditorPerProjectIni );
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "UObject/SoftObjectPath.h"
+
+class UActorComponent;
+class ULevel;
+
+// Components recently picked, and the ones pinned by the user, shown above the browse list of SComponentPicker. Both
+// lists are bounded and saved in the per-project editor settings so they survive editor restarts. Entries are keyed
+// by the level package and GUID of the owner actor and by the component name, which don't change when the actor is
+// renamed, and are resolved without loading anything. Components of PIE worlds are never added.
+class FComponentPickerRecents
+{
+public:
+    // Get the global lists, loaded from the settings on first use.
+    static FComponentPickerRecents& Get( );
+
+    // Move the component to the front of the recent list.
+    void AddRecent( const UActorComponent* pComponent );
+
+    // Pin or unpin a component.
+    void SetPinned( const UActorComponent* pComponent, bool bPinned );
+    bool IsPinned( const UActorComponent* pComponent ) const;
+
+    // Resolve the pinned and recent components that are loaded. Pinned components are not listed as recent.
+    void GetComponents( TArray<UActorComponent*>& rOutPinned, TArray<UActorComponent*>& rOutRecent ) const;
+
+private:
+    struct FEntry
+    {
+        // Identity of the component.
+        FName strLevelPackage;
+        FGuid oActorGuid;
+        FName strComponentName;
+
+        // Path of the component when it was last resolved, a single hash lookup while the owner keeps its name.
+        mutable FSoftObjectPath oPath;
+
+        // Avoids resolving the path again while the component is alive.
+        mutable TWeakObjectPtr<UActorComponent> pComponent;
+
+        // Generation of the level (see FComponentPickerIndex::GetGeneration) when the owner was last looked for in it
+        // and not found. The level is only searched again once it changed.
+        mutable uint64 nMissedGeneration = 0;
+    };
+
+    FComponentPickerRecents( );
+
+    // Make the entry of a component, returns false for components that can't be kept, e.g. the ones of PIE worlds.
+    static bool MakeEntry( const UActorComponent* pComponent, FEntry& rOutEntry );
+
+    // Resolve an entry, null if the component is not loaded.
+    static UActorComponent* Resolve( const FEntry& rEntry );
+
+    // Find the component of an entry from its identity, in the loaded level of its owner.
+    static UActorComponent* ResolveIdentity( const FEntry& rEntry );
+
+    // Find the entry of a component in a list.
+    static int32 Find( const TArray<FEntry>& rEntries, const UActorComponent* pComponent );
+
+    // Read and write the lists from the per-project editor settings.
+    static void Load( const TCHAR* pKey, TArray<FEntry>& rOutEntries );
+    static void Save( const TCHAR* pKey, const TArray<FEntry>& rEntries );
+
+private:
+    // Most recent first.
+    TArray<FEntry> m_oRecent;
+    TArray<FEntry> m_oPinned;
+};
@@ -0,0 +1,557 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerReferenceSubsystem.h"
+#include "ComponentPicker.h"
+#include "ComponentPickerCustomization.h"
+
+#include "Editor.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/TransactionObjectEvent.h"
+#include "ScopedTransaction.h"
+#include "TimerManager.h"
+#include "UObject/Package.h"
+
+#define LOCTEXT_NAMESPACE "ComponentPickerReferenceSubsystem"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerTarget FComponentPickerTarget::Make( const UActorComponent* pComponent )
+{
+    return { FSoftObjectPath( pComponent->GetOwner( ) ), pComponent->GetFName( ) };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerTarget FComponentPickerTarget::Make( const FComponentPicker& rPicker )
+{
+    return { rPicker.GetOwnerPath( ), rPicker.GetComponentName( ) };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Path the object had before it was renamed from pOldOuter and strOldName.
+static FSoftObjectPath GetPathBeforeRename( const UObject* pOldOuter, FName strOldName )
+{
+    // The objects directly outered to an asset are separated from it by a colon, as in GetPathName.
+    const UObject* pOldOuterOuter = pOldOuter->GetOuter( );
+    const bool bOuterIsAsset = pOldOuterOuter != nullptr && pOldOuterOuter->IsA<UPackage>( );
+
+    return FSoftObjectPath( FString::Printf( TEXT( "%s%s%s" ),
+                                             *pOldOuter->GetPathName( ),
+                                             bOuterIsAsset ? SUBOBJECT_DELIMITER : TEXT( "." ),
+                                             *strOldName.ToString( ) ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::Initialize( FSubsystemCollectionBase& rCollection )
+{
+    Super::Initialize( rCollection );
+
+    m_hObjectPropertyChanged = FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(
+        this, &UComponentPickerReferenceSubsystem::OnObjectPropertyChanged );
+    m_hObjectTransacted = FCoreUObjectDelegates::OnObjectTransacted.AddUObject(
+        this, &UComponentPickerReferenceSubsystem::OnObjectTransacted );
+    m_hLevelAdded =
+        FWorldDelegates::LevelAddedToWorld.AddUObject( this, &UComponentPickerReferenceSubsystem::OnLevelAdded );
+    m_hLevelRemoved =
+        FWorldDelegates::LevelRemovedFromWorld.AddUObject( this, &UComponentPickerReferenceSubsystem::OnLevelRemoved );
+    m_hPostWorldInitialization = FWorldDelegates::OnPostWorldInitialization.AddUObject(
+        this, &UComponentPickerReferenceSubsystem::OnPostWorldInitialization );
+    m_hWorldCleanup =
+        FWorldDelegates::OnWorldCleanup.AddUObject( this, &UComponentPickerReferenceSubsystem::OnWorldCleanup );
+    m_hObjectRenamed = FCoreUObjectDelegates::OnObjectRenamed.AddUObject(
+        this, &UComponentPickerReferenceSubsystem::OnObjectRenamed );
+    m_hObjectsReplaced = FCoreUObjectDelegates::OnObjectsReplaced.AddUObject(
+        this, &UComponentPickerReferenceSubsystem::OnObjectsReplaced );
+
+    if( GEngine )
+    {
+        m_hLevelActorAdded =
+            GEngine->OnLevelActorAdded( ).AddUObject( this, &UComponentPickerReferenceSubsystem::OnLevelActorAdded );
+        m_hLevelActorDeleted = GEngine->OnLevelActorDeleted( ).AddUObject(
+            this, &UComponentPickerReferenceSubsystem::OnLevelActorDeleted );
+    }
+
+    // The editor world may already be loaded.
+    if( GEditor )
+    {
+        UpdateWorld( GEditor->GetEditorWorldContext( ).World( ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::Deinitialize( )
+{
+    FCoreUObjectDelegates::OnObjectPropertyChanged.Remove( m_hObjectPropertyChanged );
+    FCoreUObjectDelegates::OnObjectTransacted.Remove( m_hObjectTransacted );
+    FWorldDelegates::LevelAddedToWorld.Remove( m_hLevelAdded );
+    FWorldDelegates::LevelRemovedFromWorld.Remove( m_hLevelRemoved );
+    FWorldDelegates::OnPostWorldInitialization.Remove( m_hPostWorldInitialization );
+    FWorldDelegates::OnWorldCleanup.Remove( m_hWorldCleanup );
+    FCoreUObjectDelegates::OnObjectRenamed.Remove( m_hObjectRenamed );
+    FCoreUObjectDelegates::OnObjectsReplaced.Remove( m_hObjectsReplaced );
+
+    if( GEngine )
+    {
+        GEngine->OnLevelActorAdded( ).Remove( m_hLevelActorAdded );
+        GEngine->OnLevelActorDeleted( ).Remove( m_hLevelActorDeleted );
+    }
+
+    m_oReferencers.Reset( );
+    m_oTargets.Reset( );
+    m_oPendingRedirects.Reset( );
+
+    Super::Deinitialize( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::FindReferencers( const UActorComponent* pComponent,
+                                                          TArray<FComponentPickerReference>& rOutReferencers ) const
+{
+    if( pComponent == nullptr )
+    {
+        return;
+    }
+
+    if( const TArray<FComponentPickerReference>* pReferencers =
+            m_oReferencers.Find( FComponentPickerTarget::Make( pComponent ) ) )
+    {
+        rOutReferencers.Append( *pReferencers );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool UComponentPickerReferenceSubsystem::IsReferenced( const UActorComponent* pComponent ) const
+{
+    return pComponent != nullptr && m_oReferencers.Contains( FComponentPickerTarget::Make( pComponent ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::UpdateReferencer( UObject* pObject )
+{
+    RemoveReferencer( pObject );
+
+    if( !IsValid( pObject ) )
+    {
+        return;
+    }
+
+    // The pickers are indexed on the identity they store, the component doesn't need to be loaded.
+    auto oAddReference = [this, pObject]( FComponentPicker& rPicker,
+                                          const FProperty* pProperty,
+                                          const FString& rPropertyPath )
+    {
+        if( !rPicker.GetComponentName( ).IsNone( ) )
+        {
+            const FComponentPickerTarget oTarget = FComponentPickerTarget::Make( rPicker );
+            m_oReferencers.FindOrAdd( oTarget ).Add( { pObject, rPropertyPath } );
+            m_oTargets.FindOrAdd( pObject ).AddUnique( oTarget );
+        }
+    };
+
+    FComponentPicker::ForEachInObject( pObject, oAddReference );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::RemoveReferencer( const UObject* pObject )
+{
+    TArray<FComponentPickerTarget> oTargets;
+
+    if( !m_oTargets.RemoveAndCopyValue( pObject, oTargets ) )
+    {
+        return;
+    }
+
+    for( const FComponentPickerTarget& rTarget : oTargets )
+    {
+        if( TArray<FComponentPickerReference>* pReferencers = m_oReferencers.Find( rTarget ) )
+        {
+            pReferencers->RemoveAll( [pObject]( const FComponentPickerReference& rReference )
+            {
+                return rReference.pReferencer.Get( true ) == pObject;
+            } );
+
+            if( pReferencers->Num( ) == 0 )
+            {
+                m_oReferencers.Remove( rTarget );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::UpdateActor( AActor* pActor )
+{
+    if( !IsValid( pActor ) )
+    {
+        return;
+    }
+
+    UpdateReferencer( pActor );
+
+    for( UActorComponent* pComponent : pActor->GetComponents( ) )
+    {
+        UpdateReferencer( pComponent );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::RemoveActor( const AActor* pActor )
+{
+    if( pActor == nullptr )
+    {
+        return;
+    }
+
+    RemoveReferencer( pActor );
+
+    for( const UActorComponent* pComponent : pActor->GetComponents( ) )
+    {
+        RemoveReferencer( pComponent );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::UpdateLevel( ULevel* pLevel )
+{
+    if( pLevel )
+    {
+        for( AActor* pActor : pLevel->Actors )
+        {
+            UpdateActor( pActor );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::RemoveLevel( const ULevel* pLevel )
+{
+    if( pLevel )
+    {
+        for( const AActor* pActor : pLevel->Actors )
+        {
+            RemoveActor( pActor );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::UpdateWorld( UWorld* pWorld )
+{
+    // Only the levels being edited are indexed, PIE and preview worlds are ignored.
+    if( pWorld && pWorld->WorldType == EWorldType::Editor )
+    {
+        for( ULevel* pLevel : pWorld->GetLevels( ) )
+        {
+            UpdateLevel( pLevel );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnObjectPropertyChanged( UObject* pObject,
+                                                                  FPropertyChangedEvent& rPropertyChangedEvent )
+{
+    UWorld* pWorld = pObject ? pObject->GetWorld( ) : nullptr;
+
+    if( pWorld && pWorld->WorldType == EWorldType::Editor )
+    {
+        UpdateReferencer( pObject );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnObjectTransacted( UObject* pObject,
+                                                             const FTransactionObjectEvent& rTransactionEvent )
+{
+    // Undo/redo restore the pickers without a property change notification.
+    if( rTransactionEvent.GetEventType( ) == ETransactionObjectEventType::UndoRedo )
+    {
+        FPropertyChangedEvent oPropertyChangedEvent( nullptr );
+        OnObjectPropertyChanged( pObject, oPropertyChangedEvent );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnLevelActorAdded( AActor* pActor )
+{
+    UWorld* pWorld = pActor ? pActor->GetWorld( ) : nullptr;
+
+    if( pWorld && pWorld->WorldType == EWorldType::Editor )
+    {
+        UpdateActor( pActor );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnLevelActorDeleted( AActor* pActor )
+{
+    RemoveActor( pActor );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnLevelAdded( ULevel* pLevel, UWorld* pWorld )
+{
+    if( pWorld && pWorld->WorldType == EWorldType::Editor )
+    {
+        UpdateLevel( pLevel );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnLevelRemoved( ULevel* pLevel, UWorld* pWorld )
+{
+    // A null level means that all the levels of the world were removed.
+    if( pLevel )
+    {
+        RemoveLevel( pLevel );
+    }
+    else if( pWorld )
+    {
+        for( const ULevel* pWorldLevel : pWorld->GetLevels( ) )
+        {
+            RemoveLevel( pWorldLevel );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnPostWorldInitialization(
+    UWorld* pWorld,
+    const UWorld::InitializationValues oInitializationValues )
+{
+    UpdateWorld( pWorld );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnWorldCleanup( UWorld* pWorld, bool bSessionEnded, bool bCleanupResources )
+{
+    OnLevelRemoved( nullptr, pWorld );
+
+    // Drop the entries of objects that were destroyed without notification.
+    for( auto It = m_oReferencers.CreateIterator( ); It; ++It )
+    {
+        It.Value( ).RemoveAll( []( const FComponentPickerReference& rReference )
+        {
+            return !rReference.pReferencer.IsValid( );
+        } );
+
+        if( It.Value( ).Num( ) == 0 )
+        {
+            It.RemoveCurrent( );
+        }
+    }
+
+    for( auto It = m_oTargets.CreateIterator( ); It; ++It )
+    {
+        if( It.Key( ).ResolveObjectPtr( ) == nullptr )
+        {
+            It.RemoveCurrent( );
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::AddRedirect( const FComponentPickerTarget& rOldTarget,
+                                                      UActorComponent* pNewComponent )
+{
+    if( m_bApplyingRedirects )
+    {
+        return;
+    }
+
+    m_oPendingRedirects.Add( rOldTarget, pNewComponent );
+
+    // Pickers that already store the identity of the new component are rewritten too, so that their weak pointer
+    // targets it.
+    const FComponentPickerTarget oNewTarget = FComponentPickerTarget::Make( pNewComponent );
+
+    if( !( oNewTarget == rOldTarget ) )
+    {
+        m_oPendingRedirects.Add( oNewTarget, pNewComponent );
+    }
+
+    // A Blueprint compile renames and replaces many objects in a row, they are all fixed up at once.
+    if( !m_bRedirectsPending && GEditor )
+    {
+        m_bRedirectsPending = true;
+        GEditor->GetTimerManager( )->SetTimerForNextTick(
+            FTimerDelegate::CreateUObject( this, &UComponentPickerReferenceSubsystem::ApplyPendingRedirects ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::ApplyPendingRedirects( )
+{
+    m_bRedirectsPending = false;
+
+    TMap<FComponentPickerTarget, TWeakObjectPtr<UActorComponent>> oRedirects = MoveTemp( m_oPendingRedirects );
+    m_oPendingRedirects.Reset( );
+
+    // Only the objects that pick a redirected component are visited.
+    TSet<UObject*> oReferencers;
+
+    for( const auto& rRedirect : oRedirects )
+    {
+        if( const TArray<FComponentPickerReference>* pReferencers = m_oReferencers.Find( rRedirect.Key ) )
+        {
+            for( const FComponentPickerReference& rReference : *pReferencers )
+            {
+                if( UObject* pReferencer = rReference.pReferencer.Get( ) )
+                {
+                    oReferencers.Add( pReferencer );
+                }
+            }
+        }
+    }
+
+    if( oReferencers.Num( ) == 0 )
+    {
+        return;
+    }
+
+    const FScopedTransaction oTransaction( LOCTEXT( "RedirectComponentPickers", "Fix Up Component Pickers" ) );
+    TGuardValue<bool> oApplyingRedirects( m_bApplyingRedirects, true );
+    int32 nNumRedirectedPickers = 0;
+
+    for( UObject* pReferencer : oReferencers )
+    {
+        // Properties holding the redirected pickers, the array property for array elements.
+        TArray<const FProperty*, TInlineAllocator<4>> oModifiedProperties;
+
+        FComponentPicker::ForEachInObject( pReferencer, [&]( FComponentPicker& rPicker,
+                                                             const FProperty* pProperty,
+                                                             const FString& rPropertyPath )
+        {
+            const TWeakObjectPtr<UActorComponent>* pNewComponent =
+                oRedirects.Find( FComponentPickerTarget::Make( rPicker ) );
+
+            if( pNewComponent == nullptr || !pNewComponent->IsValid( ) )
+            {
+                return;
+            }
+
+            const FComponentPicker oRedirectedPicker( pNewComponent->Get( ) );
+
+            if( rPicker == oRedirectedPicker )
+            {
+                return;
+            }
+
+            // A typed picker keeps its component class, a replacement of another class is not redirected.
+            const FProperty* pValueProperty = pProperty;
+
+            if( const FArrayProperty* pArrayProperty = CastField<FArrayProperty>( pProperty ) )
+            {
+                pValueProperty = pArrayProperty->Inner;
+            }
+
+            const FStructProperty* pStructProperty = CastField<FStructProperty>( pValueProperty );
+            const UClass* pRequiredComponentClass = pStructProperty
+                ? FComponentPickerCustomization::FindTypedPickerClass( pStructProperty->Struct )
+                : nullptr;
+
+            if( pRequiredComponentClass && !pNewComponent->Get( )->IsA( pRequiredComponentClass ) )
+            {
+                return;
+            }
+
+            if( oModifiedProperties.Num( ) == 0 )
+            {
+                pReferencer->Modify( );
+            }
+
+            oModifiedProperties.AddUnique( pProperty );
+            rPicker = oRedirectedPicker;
+            ++nNumRedirectedPickers;
+        } );
+
+        // Only the picker properties are notified. PostEditChange( ) would notify a change of the whole object and
+        // rerun the construction scripts of actors.
+        for( const FProperty* pModifiedProperty : oModifiedProperties )
+        {
+            FPropertyChangedEvent oPropertyChangedEvent( const_cast<FProperty*>( pModifiedProperty ),
+                                                         EPropertyChangeType::ValueSet );
+            pReferencer->PostEditChangeProperty( oPropertyChangedEvent );
+        }
+
+        // The index is keyed by the old identities.
+        UpdateReferencer( pReferencer );
+    }
+
+    UE_LOG( LogComponentPicker, Verbose, TEXT( "Redirected %d picker(s) in %d object(s)" ),
+            nNumRedirectedPickers, oReferencers.Num( ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnObjectRenamed( UObject* pObject, UObject* pOldOuter, FName strOldName )
+{
+    // Only user edits are followed. Construction scripts and deletions move the old components out of the way with
+    // non-transactional renames, into the transient package or under a TRASH_ name. The components created again by
+    // construction scripts take the identity the pickers are indexed on.
+    if( m_bApplyingRedirects ||
+        pObject == nullptr ||
+        GUndo == nullptr ||
+        !pObject->HasAnyFlags( RF_Transactional ) ||
+        pObject->GetOutermost( ) == GetTransientPackage( ) ||
+        pObject->GetName( ).StartsWith( TEXT( "TRASH_" ) ) )
+    {
+        return;
+    }
+
+    // Renaming the owner changes the stable identity of all its components. Moving a component to another actor is
+    // a rename with a new outer. The pickers are indexed on the identity before the rename.
+    if( UActorComponent* pComponent = Cast<UActorComponent>( pObject ) )
+    {
+        const AActor* pOldOwner = Cast<AActor>( pOldOuter );
+        const FComponentPickerTarget oOldTarget = {
+            FSoftObjectPath( pOldOwner ? pOldOwner : pComponent->GetOwner( ) ), strOldName };
+
+        if( m_oReferencers.Contains( oOldTarget ) )
+        {
+            AddRedirect( oOldTarget, pComponent );
+        }
+    }
+    else if( AActor* pActor = Cast<AActor>( pObject ) )
+    {
+        const FSoftObjectPath oOldActorPath =
+            pOldOuter ? GetPathBeforeRename( pOldOuter, strOldName ) : FSoftObjectPath( pActor );
+
+        for( UActorComponent* pActorComponent : pActor->GetComponents( ) )
+        {
+            if( pActorComponent == nullptr )
+            {
+                continue;
+            }
+
+            const FComponentPickerTarget oOldTarget = { oOldActorPath, pActorComponent->GetFName( ) };
+
+            if( m_oReferencers.Contains( oOldTarget ) )
+            {
+                AddRedirect( oOldTarget, pActorComponent );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UComponentPickerReferenceSubsystem::OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap )
+{
+    for( const TPair<UObject*, UObject*>& rReplacement : rReplacementMap )
+    {
+        UActorComponent* pOldComponent = Cast<UActorComponent>( rReplacement.Key );
+        UActorComponent* pNewComponent = Cast<UActorComponent>( rReplacement.Value );
+
+        if( pOldComponent && pNewComponent && IsReferenced( pOldComponent ) )
+        {
+            AddRedirect( FComponentPickerTarget::Make( pOldComponent ), pNewComponent );
+        }
+
+        // The replaced objects may hold pickers themselves.
+        if( m_oTargets.Contains( rReplacement.Key ) )
+        {
+            RemoveReferencer( rReplacement.Key );
+            UpdateReferencer( rReplacement.Value );
+        }
+    }
+}
+
+#undef LOCTEXT_NAMESPACE
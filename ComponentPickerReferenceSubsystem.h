@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "EditorSubsystem.h"
+#include "Engine/World.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/SoftObjectPath.h"
+
+#include "ComponentPickerReferenceSubsystem.generated.h"
+
+class AActor;
+class UActorComponent;
+class ULevel;
+struct FComponentPicker;
+
+// Stable identity of a picked component: the path of its owner and its name. Construction scripts destroy and create
+// again the components of an actor without notification, the new components keep the identity of the old ones.
+struct FComponentPickerTarget
+{
+    FSoftObjectPath oOwnerPath;
+    FName strComponentName;
+
+    // Identity of a loaded component, and the one stored by a picker.
+    static FComponentPickerTarget Make( const UActorComponent* pComponent );
+    static FComponentPickerTarget Make( const FComponentPicker& rPicker );
+
+    bool operator==( const FComponentPickerTarget& rOther ) const
+    {
+        return strComponentName == rOther.strComponentName && oOwnerPath == rOther.oOwnerPath;
+    }
+
+    friend uint32 GetTypeHash( const FComponentPickerTarget& rTarget )
+    {
+        return HashCombine( GetTypeHash( rTarget.oOwnerPath ), GetTypeHash( rTarget.strComponentName ) );
+    }
+};
+
+// A FComponentPicker value that targets a component.
+struct FComponentPickerReference
+{
+    // Object holding the picker (an actor or a component).
+    TWeakObjectPtr<UObject> pReferencer;
+
+    // Path of the picker property relative to the referencer, e.g. "m_oTargets[2].m_oComponent".
+    FString strPropertyPath;
+};
+
+// Reverse index of the FComponentPicker values of the loaded editor levels: for every picked component, the objects
+// and properties that pick it. The index is built when levels are loaded and updated on property changes, undo/redo,
+// actor add/delete and level unload, so finding who picks a component doesn't need to scan the level. It is keyed on
+// the stable identity of the components, so it still answers for the components created again by construction
+// scripts.
+//
+// The index is also used to fix up the pickers when a picked component is renamed, moved to another actor or replaced
+// (Blueprint recompile, reinstancing): the redirects of a frame are gathered and applied on the next tick, only to
+// the objects that pick a redirected component, in a single transaction.
+UCLASS( )
+class UComponentPickerReferenceSubsystem : public UEditorSubsystem
+{
+    GENERATED_BODY( )
+
+public:
+    // START UEditorSubsystem interface.
+    virtual void Initialize( FSubsystemCollectionBase& rCollection ) override;
+    virtual void Deinitialize( ) override;
+    // END UEditorSubsystem interface.
+
+    // Get the pickers that target this component.
+    void FindReferencers( const UActorComponent* pComponent, TArray<FComponentPickerReference>& rOutReferencers ) const;
+
+    // Returns whether any picker targets this component, e.g. to warn before deleting it.
+    bool IsReferenced( const UActorComponent* pComponent ) const;
+
+    // Index the pickers of an object again.
+    void UpdateReferencer( UObject* pObject );
+
+    // Remove the pickers of an object from the index.
+    void RemoveReferencer( const UObject* pObject );
+
+private:
+    // Index or remove an actor and its components.
+    void UpdateActor( AActor* pActor );
+    void RemoveActor( const AActor* pActor );
+
+    // Index or remove every actor of a level.
+    void UpdateLevel( ULevel* pLevel );
+    void RemoveLevel( const ULevel* pLevel );
+
+    // Index every level of a world.
+    void UpdateWorld( UWorld* pWorld );
+
+    // Queue a redirect of the pickers targeting rOldTarget to pNewComponent. When the component was renamed or moved,
+    // rOldTarget is its identity before the change and the pickers only need their stable identity updated.
+    void AddRedirect( const FComponentPickerTarget& rOldTarget, UActorComponent* pNewComponent );
+
+    // Rewrite the pickers targeting the redirected components.
+    void ApplyPendingRedirects( );
+
+    // Engine callbacks.
+    void OnObjectPropertyChanged( UObject* pObject, FPropertyChangedEvent& rPropertyChangedEvent );
+    void OnObjectTransacted( UObject* pObject, const class FTransactionObjectEvent& rTransactionEvent );
+    void OnLevelActorAdded( AActor* pActor );
+    void OnLevelActorDeleted( AActor* pActor );
+    void OnLevelAdded( ULevel* pLevel, UWorld* pWorld );
+    void OnLevelRemoved( ULevel* pLevel, UWorld* pWorld );
+    void OnPostWorldInitialization( UWorld* pWorld, const UWorld::InitializationValues oInitializationValues );
+    void OnWorldCleanup( UWorld* pWorld, bool bSessionEnded, bool bCleanupResources );
+    void OnObjectRenamed( UObject* pObject, UObject* pOldOuter, FName strOldName );
+    void OnObjectsReplaced( const TMap<UObject*, UObject*>& rReplacementMap );
+
+private:
+    // Identity of the picked component -> pickers targeting it
+    TMap<FComponentPickerTarget, TArray<FComponentPickerReference>> m_oReferencers;
+
+    // Referencer -> identities of the components it picks, used to update the index when the referencer changes
+    TMap<TObjectKey<UObject>, TArray<FComponentPickerTarget>> m_oTargets;
+
+    // Identity of the redirected component -> component the pickers must target, applied on the next tick
+    TMap<FComponentPickerTarget, TWeakObjectPtr<UActorComponent>> m_oPendingRedirects;
+    bool m_bRedirectsPending = false;
+
+    // Set while the redirects are applied: the change notifications can rerun construction scripts, whose renames
+    // and replacements must not queue redirects again
+    bool m_bApplyingRedirects = false;
+
+    FDelegateHandle m_hObjectPropertyChanged;
+    FDelegateHandle m_hObjectTransacted;
+    FDelegateHandle m_hLevelActorAdded;
+    FDelegateHandle m_hLevelActorDeleted;
+    FDelegateHandle m_hLevelAdded;
+    FDelegateHandle m_hLevelRemoved;
+    FDelegateHandle m_hPostWorldInitialization;
+    FDelegateHandle m_hWorldCleanup;
+    FDelegateHandle m_hObjectRenamed;
+    FDelegateHandle m_hObjectsReplaced;
+};
@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerSearchIndex.h"
+
+#include "Algo/Sort.h"
+
+// Number of characters of the n-grams.
+static constexpr int32 SearchGramLength = 3;
+
+// Ratio of the query trigrams an entry must contain to be a fuzzy match.
+static constexpr float SearchMinTrigramRatio = 0.5f;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FComponentPickerSearchIndex::FComponentPickerSearchIndex( TArray<FEntry>&& rEntries )
+    : m_oEntries( MoveTemp( rEntries ) )
+{
+    TArray<FGram> oGrams;
+
+    for( int32 nEntry = 0; nEntry < m_oEntries.Num( ); ++nEntry )
+    {
+        FEntry& rEntry = m_oEntries[nEntry];
+        rEntry.strActorLabel.ToLowerInline( );
+        rEntry.strComponentName.ToLowerInline( );
+        rEntry.strVariableName.ToLowerInline( );
+
+        // Grams don't span two strings.
+        oGrams.Reset( );
+
+        for( int32 nGramLength = 1; nGramLength <= SearchGramLength; ++nGramLength )
+        {
+            GatherGrams( rEntry.strActorLabel, nGramLength, oGrams );
+            GatherGrams( rEntry.strComponentName, nGramLength, oGrams );
+            GatherGrams( rEntry.strVariableName, nGramLength, oGrams );
+        }
+
+        for( FGram nGram : oGrams )
+        {
+            TArray<int32>& rPostings = m_oPostings.FindOrAdd( nGram );
+
+            // Entries are added in order, a gram found twice in the entry is the last posting.
+            if( rPostings.Num( ) == 0 || rPostings.Last( ) != nEntry )
+            {
+                rPostings.Add( nEntry );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerSearchIndex::Query( const FString& rQuery, int32 nMaxResults, TArray<int32>& rOutIds ) const
+{
+    const FString strQuery = rQuery.TrimStartAndEnd( ).ToLower( );
+
+    if( strQuery.IsEmpty( ) || nMaxResults <= 0 )
+    {
+        return;
+    }
+
+    struct FMatch
+    {
+        int32 nEntry;
+        float fScore;
+    };
+
+    // Best score first, the index order is kept between equal scores.
+    auto oIsBetter = []( const FMatch& rA, const FMatch& rB )
+    {
+        return rA.fScore != rB.fScore ? rA.fScore > rB.fScore : rA.nEntry < rB.nEntry;
+    };
+
+    auto oIsWorse = [&oIsBetter]( const FMatch& rA, const FMatch& rB )
+    {
+        return oIsBetter( rB, rA );
+    };
+
+    // Only the nMaxResults best matches are kept, in a heap whose top is the worst of them.
+    TArray<FMatch> oMatches;
+    oMatches.Reserve( FMath::Min( nMaxResults, m_oEntries.Num( ) ) );
+
+    auto oAddMatch = [&]( int32 nEntry, float fScore )
+    {
+        const FMatch oMatch = { nEntry, fScore };
+
+        if( oMatches.Num( ) < nMaxResults )
+        {
+            oMatches.HeapPush( oMatch, oIsWorse );
+        }
+        else if( oIsBetter( oMatch, oMatches.HeapTop( ) ) )
+        {
+            oMatches.HeapPopDiscard( oIsWorse, false );
+            oMatches.HeapPush( oMatch, oIsWorse );
+        }
+    };
+
+    if( strQuery.Len( ) < SearchGramLength )
+    {
+        // Too short to have trigrams: the query is a gram of its own, every entry containing it is a substring match.
+        TArray<FGram> oQueryGrams;
+        GatherGrams( strQuery, strQuery.Len( ), oQueryGrams );
+
+        if( const TArray<int32>* pPostings = m_oPostings.Find( oQueryGrams[0] ) )
+        {
+            for( int32 nEntry : *pPostings )
+            {
+                const float fScore = ScoreEntry( m_oEntries[nEntry], strQuery, 0.0f );
+
+                if( fScore > 0.0f )
+                {
+                    oAddMatch( nEntry, fScore );
+                }
+            }
+        }
+    }
+    else
+    {
+        TArray<FGram> oQueryTrigrams;
+        GatherGrams( strQuery, SearchGramLength, oQueryTrigrams );
+
+        // Count the query trigrams of every entry sharing at least one.
+        TArray<uint16> oHitCounts;
+        oHitCounts.SetNumZeroed( m_oEntries.Num( ) );
+        TArray<int32> oHitEntries;
+
+        for( FGram nTrigram : oQueryTrigrams )
+        {
+            if( const TArray<int32>* pPostings = m_oPostings.Find( nTrigram ) )
+            {
+                for( int32 nEntry : *pPostings )
+                {
+                    if( oHitCounts[nEntry]++ == 0 )
+                    {
+                        oHitEntries.Add( nEntry );
+                    }
+                }
+            }
+        }
+
+        const int32 nMinHitCount =
+            FMath::Max( 1, FMath::CeilToInt( oQueryTrigrams.Num( ) * SearchMinTrigramRatio ) );
+
+        for( int32 nEntry : oHitEntries )
+        {
+            if( oHitCounts[nEntry] >= nMinHitCount )
+            {
+                const float fTrigramRatio = static_cast<float>( oHitCounts[nEntry] ) / oQueryTrigrams.Num( );
+                oAddMatch( nEntry, ScoreEntry( m_oEntries[nEntry], strQuery, fTrigramRatio ) );
+            }
+        }
+    }
+
+    Algo::Sort( oMatches, oIsBetter );
+
+    rOutIds.Reserve( rOutIds.Num( ) + oMatches.Num( ) );
+
+    for( const FMatch& rMatch : oMatches )
+    {
+        rOutIds.Add( m_oEntries[rMatch.nEntry].nId );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int32 FComponentPickerSearchIndex::Num( ) const
+{
+    return m_oEntries.Num( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerSearchIndex::GatherGrams( const FString& rString, int32 nGramLength, TArray<FGram>& rOutGrams )
+{
+    // A trigram only uses the 63 low bits: bigrams set bit 63, single characters set bits 63 and 62.
+    const FGram nTag = nGramLength == 1 ? ( FGram( 3 ) << 62 ) : nGramLength == 2 ? ( FGram( 1 ) << 63 ) : 0;
+
+    for( int32 nStart = 0; nStart + nGramLength <= rString.Len( ); ++nStart )
+    {
+        // 21 bits per character are enough for every code point.
+        FGram nGram = 0;
+
+        for( int32 nChar = 0; nChar < nGramLength; ++nChar )
+        {
+            nGram = ( nGram << 21 ) | static_cast<FGram>( rString[nStart + nChar] & 0x1FFFFF );
+        }
+
+        rOutGrams.AddUnique( nGram | nTag );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float FComponentPickerSearchIndex::ScoreEntry( const FEntry& rEntry, const FString& rQuery, float fTrigramRatio )
+{
+    float fBestScore = 0.0f;
+
+    for( const FString* pString : { &rEntry.strComponentName, &rEntry.strVariableName, &rEntry.strActorLabel } )
+    {
+        float fScore = 0.0f;
+
+        if( pString->Equals( rQuery, ESearchCase::CaseSensitive ) )
+        {
+            fScore = 4.0f;
+        }
+        else if( pString->StartsWith( rQuery, ESearchCase::CaseSensitive ) )
+        {
+            fScore = 3.0f;
+        }
+        else if( pString->Contains( rQuery, ESearchCase::CaseSensitive ) )
+        {
+            fScore = 2.0f;
+        }
+
+        // Among substring matches, prefer the strings that the query covers the most.
+        if( fScore > 0.0f )
+        {
+            fScore += static_cast<float>( rQuery.Len( ) ) / pString->Len( );
+        }
+
+        fBestScore = FMath::Max( fBestScore, fScore );
+    }
+
+    return fBestScore + fTrigramRatio;
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Trigram index over the search strings of the picker candidates: actor label, component name and Blueprint variable
+// name. A query only scores the entries sharing trigrams with it, instead of matching every label, and the results are
+// ranked by match quality (exact, prefix, substring, then fuzzy). Queries shorter than a trigram use the postings of
+// their single and double characters. The index is immutable once built, so it can be built and queried from worker
+// threads.
+class FComponentPickerSearchIndex
+{
+public:
+    // Search strings of one candidate.
+    struct FEntry
+    {
+        // Identifier returned by Query, e.g. the index of the candidate.
+        int32 nId = INDEX_NONE;
+
+        FString strActorLabel;
+        FString strComponentName;
+        FString strVariableName;
+    };
+
+    // Build the index. The strings are lower-cased, the search is case insensitive.
+    explicit FComponentPickerSearchIndex( TArray<FEntry>&& rEntries );
+
+    // Get the ids of the entries matching the query, best match first.
+    void Query( const FString& rQuery, int32 nMaxResults, TArray<int32>& rOutIds ) const;
+
+    // Number of indexed entries.
+    int32 Num( ) const;
+
+private:
+    // Packed characters of a trigram, or of a shorter gram tagged in the high bits so that it never equals a trigram.
+    typedef uint64 FGram;
+
+    // Add the unique grams of nGramLength characters of a lower-cased string to rOutGrams.
+    static void GatherGrams( const FString& rString, int32 nGramLength, TArray<FGram>& rOutGrams );
+
+    // Score an entry against a lower-cased query. fTrigramRatio is the ratio of query trigrams found in the entry.
+    static float ScoreEntry( const FEntry& rEntry, const FString& rQuery, float fTrigramRatio );
+
+private:
+    TArray<FEntry> m_oEntries;
+
+    // Gram -> positions in m_oEntries of the entries containing it, in increasing order
+    TMap<FGram, TArray<int32>> m_oPostings;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerStats.h"
+
+#include "HAL/IConsoleManager.h"
+
+#include <atomic>
+
+DEFINE_STAT( STAT_ComponentPicker_CustomizeHeader );
+DEFINE_STAT( STAT_ComponentPicker_BuildClassFilters );
+DEFINE_STAT( STAT_ComponentPicker_Construct );
+DEFINE_STAT( STAT_ComponentPicker_PassesFilter );
+DEFINE_STAT( STAT_ComponentPicker_IsFilteredComponent );
+DEFINE_STAT( STAT_ComponentPicker_GetValue );
+DEFINE_STAT( STAT_ComponentPicker_SetValue );
+DEFINE_STAT( STAT_ComponentPicker_OnPropertyValueChanged );
+
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Items Passed" ), STAT_ComponentPicker_ItemsPassed, STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Items Filtered" ),
+                                STAT_ComponentPicker_ItemsFiltered,
+                                STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Filter Cache Hits" ),
+                                STAT_ComponentPicker_FilterCacheHits,
+                                STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Filter Cache Misses" ),
+                                STAT_ComponentPicker_FilterCacheMisses,
+                                STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Class Verdict Hits" ),
+                                STAT_ComponentPicker_ClassVerdictHits,
+                                STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Class Verdict Misses" ),
+                                STAT_ComponentPicker_ClassVerdictMisses,
+                                STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Revalidations" ),
+                                STAT_ComponentPicker_Revalidations,
+                                STATGROUP_ComponentPicker );
+DECLARE_DWORD_ACCUMULATOR_STAT( TEXT( "Avoided Revalidations" ),
+                                STAT_ComponentPicker_AvoidedRevalidations,
+                                STATGROUP_ComponentPicker );
+
+static constexpr int32 ComponentPickerCounterCount = static_cast<int32>( FComponentPickerStats::ECounter::Count );
+
+static std::atomic<uint64> GComponentPickerCounters[ComponentPickerCounterCount];
+
+static const TCHAR* const GComponentPickerCounterNames[ComponentPickerCounterCount] =
+{
+    TEXT( "ItemsPassed" ),
+    TEXT( "ItemsFiltered" ),
+    TEXT( "FilterCacheHits" ),
+    TEXT( "FilterCacheMisses" ),
+    TEXT( "ClassVerdictHits" ),
+    TEXT( "ClassVerdictMisses" ),
+    TEXT( "Revalidations" ),
+    TEXT( "AvoidedRevalidations" ),
+};
+
+static FAutoConsoleCommandWithOutputDevice GComponentPickerDumpStatsCommand(
+    TEXT( "ComponentPicker.DumpStats" ),
+    TEXT( "Print the component picker counters aggregated since startup or the last ComponentPicker.ResetStats." ),
+    FConsoleCommandWithOutputDeviceDelegate::CreateStatic( &FComponentPickerStats::Dump ) );
+
+static FAutoConsoleCommand GComponentPickerResetStatsCommand(
+    TEXT( "ComponentPicker.ResetStats" ),
+    TEXT( "Set the component picker counters back to zero." ),
+    FConsoleCommandDelegate::CreateStatic( &FComponentPickerStats::Reset ) );
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerStats::Increment( ECounter eCounter, uint64 nAmount )
+{
+    GComponentPickerCounters[static_cast<int32>( eCounter )].fetch_add( nAmount, std::memory_order_relaxed );
+
+    switch( eCounter )
+    {
+        case ECounter::ItemsPassed: INC_DWORD_STAT_BY( STAT_ComponentPicker_ItemsPassed, nAmount ); break;
+        case ECounter::ItemsFiltered: INC_DWORD_STAT_BY( STAT_ComponentPicker_ItemsFiltered, nAmount ); break;
+        case ECounter::FilterCacheHits: INC_DWORD_STAT_BY( STAT_ComponentPicker_FilterCacheHits, nAmount ); break;
+        case ECounter::FilterCacheMisses: INC_DWORD_STAT_BY( STAT_ComponentPicker_FilterCacheMisses, nAmount ); break;
+        case ECounter::ClassVerdictHits: INC_DWORD_STAT_BY( STAT_ComponentPicker_ClassVerdictHits, nAmount ); break;
+        case ECounter::ClassVerdictMisses: INC_DWORD_STAT_BY( STAT_ComponentPicker_ClassVerdictMisses, nAmount ); break;
+        case ECounter::Revalidations: INC_DWORD_STAT_BY( STAT_ComponentPicker_Revalidations, nAmount ); break;
+        case ECounter::AvoidedRevalidations:
+            INC_DWORD_STAT_BY( STAT_ComponentPicker_AvoidedRevalidations, nAmount );
+            break;
+        default: break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64 FComponentPickerStats::Get( ECounter eCounter )
+{
+    return GComponentPickerCounters[static_cast<int32>( eCounter )].load( std::memory_order_relaxed );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerStats::Reset( )
+{
+    for( std::atomic<uint64>& rCounter : GComponentPickerCounters )
+    {
+        rCounter.store( 0, std::memory_order_relaxed );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FComponentPickerStats::Dump( FOutputDevice& rOutputDevice )
+{
+    rOutputDevice.Logf( TEXT( "Component picker counters:" ) );
+
+    for( int32 nCounter = 0; nCounter < ComponentPickerCounterCount; ++nCounter )
+    {
+        rOutputDevice.Logf( TEXT( "  %-24s %llu" ),
+                            GComponentPickerCounterNames[nCounter],
+                            Get( static_cast<ECounter>( nCounter ) ) );
+    }
+
+    auto oLogRatio = [&rOutputDevice]( const TCHAR* pName, uint64 nHits, uint64 nMisses )
+    {
+        const uint64 nTotal = nHits + nMisses;
+        rOutputDevice.Logf( TEXT( "  %-24s %.1f%%" ), pName, nTotal > 0 ? 100.0 * nHits / nTotal : 0.0 );
+    };
+
+    oLogRatio( TEXT( "FilterCacheHitRate" ), Get( ECounter::FilterCacheHits ), Get( ECounter::FilterCacheMisses ) );
+    oLogRatio( TEXT( "ClassVerdictHitRate" ), Get( ECounter::ClassVerdictHits ), Get( ECounter::ClassVerdictMisses ) );
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP( TEXT( "ComponentPicker" ), STATGROUP_ComponentPicker, STATCAT_Advanced );
+
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "CustomizeHeader" ),
+                           STAT_ComponentPicker_CustomizeHeader,
+                           STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "BuildClassFilters" ),
+                           STAT_ComponentPicker_BuildClassFilters,
+                           STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Construct" ), STAT_ComponentPicker_Construct, STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "PassesFilter" ), STAT_ComponentPicker_PassesFilter, STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "IsFilteredComponent" ),
+                           STAT_ComponentPicker_IsFilteredComponent,
+                           STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "GetValue" ), STAT_ComponentPicker_GetValue, STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "SetValue" ), STAT_ComponentPicker_SetValue, STATGROUP_ComponentPicker, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "OnPropertyValueChanged" ),
+                           STAT_ComponentPicker_OnPropertyValueChanged,
+                           STATGROUP_ComponentPicker, );
+
+// Time a scope in the ComponentPicker stat group. Cycle counters already emit Unreal Insights CPU events, builds
+// without stats only get the trace event.
+#if STATS
+#define COMPONENT_PICKER_SCOPE( Name ) SCOPE_CYCLE_COUNTER( STAT_ComponentPicker_##Name )
+#else
+#define COMPONENT_PICKER_SCOPE( Name ) TRACE_CPUPROFILER_EVENT_SCOPE( ComponentPicker_##Name )
+#endif
+
+// Counters aggregated since startup (or the last reset). They are also shown as accumulators by "stat ComponentPicker"
+// and can be dumped with the ComponentPicker.DumpStats console command. Can be incremented from any thread.
+class FComponentPickerStats
+{
+public:
+    enum class ECounter : uint8
+    {
+        // Picker candidates that passed or were rejected by the actor and component filters
+        ItemsPassed,
+        ItemsFiltered,
+
+        // FComponentPickerClassFilterCache lookups
+        FilterCacheHits,
+        FilterCacheMisses,
+
+        // Class verdicts found in the memo of a class filter, or computed by walking the filter lists
+        ClassVerdictHits,
+        ClassVerdictMisses,
+
+        // Revalidations of a customization, and change notifications merged into one already scheduled
+        Revalidations,
+        AvoidedRevalidations,
+
+        Count
+    };
+
+    // Add nAmount to a counter.
+    static void Increment( ECounter eCounter, uint64 nAmount = 1 );
+
+    // Get the current value of a counter.
+    static uint64 Get( ECounter eCounter );
+
+    // Set every counter back to zero.
+    static void Reset( );
+
+    // Write every counter to rOutputDevice.
+    static void Dump( FOutputDevice& rOutputDevice );
+};
@@ -0,0 +1,342 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentPickerValidationCommandlet.h"
+#include "ComponentPicker.h"
+#include "ComponentPickerCustomization.h"
+
+#include "Async/ParallelFor.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/Package.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionActorDesc.h"
+#include "WorldPartition/WorldPartitionHelpers.h"
+
+namespace ComponentPickerValidation
+{
+    // A picker value found in a map.
+    struct FJob
+    {
+        // Path of the object holding the picker, and of the picker relative to it.
+        FString strReferencerPath;
+        FString strPropertyPath;
+
+        // Gathered on the game thread, the validation itself only reads the input and the class filters.
+        const UActorComponent* pComponent = nullptr;
+        FComponentPickerValidationInput oInput;
+        bool bAllowAnyActor = false;
+        bool bEmpty = false;
+        TSharedPtr<const FComponentPickerClassFilters> pClassFilters;
+
+        // Filled by the validation, empty if the value is valid.
+        FString strIssue;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static const TCHAR* GetIssueName( EComponentPickerValidation eValidation )
+    {
+        switch( eValidation )
+        {
+            case EComponentPickerValidation::OtherActor: return TEXT( "OtherActor" );
+            case EComponentPickerValidation::OtherLevel: return TEXT( "OtherLevel" );
+            case EComponentPickerValidation::NotEditable: return TEXT( "NotEditable" );
+            case EComponentPickerValidation::FilteredOut: return TEXT( "FilteredOut" );
+            default: return TEXT( "" );
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void GatherJobs( UObject* pObject, const AActor* pOuterActor, TArray<FJob>& rOutJobs )
+    {
+        const FString strReferencerPath = pObject->GetPathName( );
+
+        FComponentPicker::ForEachInObject( pObject, [&]( FComponentPicker& rPicker,
+                                                         const FProperty* pProperty,
+                                                         const FString& rPropertyPath )
+        {
+            // Typed pickers are filtered by their component class instead of the AllowedClasses metadata, as in the
+            // details panel.
+            const FProperty* pValueProperty = pProperty;
+
+            if( const FArrayProperty* pArrayProperty = CastField<FArrayProperty>( pProperty ) )
+            {
+                pValueProperty = pArrayProperty->Inner;
+            }
+
+            const FStructProperty* pStructProperty = CastField<FStructProperty>( pValueProperty );
+            const UClass* pRequiredComponentClass = pStructProperty
+                ? FComponentPickerCustomization::FindTypedPickerClass( pStructProperty->Struct )
+                : nullptr;
+
+            FJob& rJob = rOutJobs.AddDefaulted_GetRef( );
+            rJob.strReferencerPath = strReferencerPath;
+            rJob.strPropertyPath = rPropertyPath;
+            rJob.pComponent = rPicker.GetComponent( );
+            rJob.bEmpty = rPicker == FComponentPicker( );
+            rJob.bAllowAnyActor = pProperty->HasMetaData( FComponentPickerCustomization::NAME_AllowAnyActor );
+            rJob.pClassFilters = FComponentPickerClassFilterCache::Get( ).FindOrBuild(
+                pProperty->GetMetaData( FComponentPickerCustomization::NAME_AllowedClasses ),
+                pProperty->GetMetaData( FComponentPickerCustomization::NAME_DisallowedClasses ),
+                rJob.bAllowAnyActor,
+                pRequiredComponentClass );
+
+            if( rJob.pComponent != nullptr )
+            {
+                rJob.oInput = FComponentPickerCustomization::GatherValidationInput(
+                    rJob.pComponent, pOuterActor, rJob.bAllowAnyActor );
+            }
+        } );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void GatherJobs( AActor* pActor, TArray<FJob>& rOutJobs )
+    {
+        GatherJobs( pActor, pActor, rOutJobs );
+
+        for( UActorComponent* pComponent : pActor->GetComponents( ) )
+        {
+            if( IsValid( pComponent ) )
+            {
+                GatherJobs( pComponent, pActor, rOutJobs );
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void GatherJobs( UWorld* pWorld, TArray<FJob>& rOutJobs, TSet<FGuid>& rOutGatheredActors )
+    {
+        for( ULevel* pLevel : pWorld->GetLevels( ) )
+        {
+            for( AActor* pActor : pLevel ? pLevel->Actors : TArray<AActor*>( ) )
+            {
+                if( IsValid( pActor ) )
+                {
+                    GatherJobs( pActor, rOutJobs );
+                    rOutGatheredActors.Add( pActor->GetActorGuid( ) );
+                }
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void ValidateJobs( TArray<FJob>& rJobs, bool bAllowEmpty )
+    {
+        // The rules only read the gathered input, and the class filters are thread-safe.
+        ParallelFor( rJobs.Num( ), [&rJobs, bAllowEmpty]( int32 nIndex )
+        {
+            FJob& rJob = rJobs[nIndex];
+
+            if( rJob.pComponent == nullptr )
+            {
+                if( !rJob.bEmpty )
+                {
+                    rJob.strIssue = TEXT( "Unresolved" );
+                }
+                else if( !bAllowEmpty )
+                {
+                    rJob.strIssue = TEXT( "Empty" );
+                }
+
+                return;
+            }
+
+            const EComponentPickerValidation eValidation = FComponentPickerCustomization::ValidateComponent(
+                rJob.oInput, rJob.bAllowAnyActor, *rJob.pClassFilters );
+
+            if( eValidation != EComponentPickerValidation::Valid )
+            {
+                rJob.strIssue = GetIssueName( eValidation );
+            }
+        } );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void AddIssue( const FString& rMapPackage, const FString& rIssue, const FString& rObjectPath,
+                          const FString& rPropertyPath, const FString& rComponentPath,
+                          TArray<TSharedPtr<FJsonValue>>& rOutJsonIssues )
+    {
+        TSharedRef<FJsonObject> pJsonIssue = MakeShared<FJsonObject>( );
+        pJsonIssue->SetStringField( TEXT( "Map" ), rMapPackage );
+        pJsonIssue->SetStringField( TEXT( "Issue" ), rIssue );
+        pJsonIssue->SetStringField( TEXT( "Object" ), rObjectPath );
+        pJsonIssue->SetStringField( TEXT( "Property" ), rPropertyPath );
+        pJsonIssue->SetStringField( TEXT( "Component" ), rComponentPath );
+        rOutJsonIssues.Add( MakeShared<FJsonValueObject>( pJsonIssue ) );
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void ValidateAndReportJobs( const FString& rMapPackage, TArray<FJob>& rJobs, bool bAllowEmpty,
+                                       int32& rNumPickers, TArray<TSharedPtr<FJsonValue>>& rOutJsonIssues )
+    {
+        ValidateJobs( rJobs, bAllowEmpty );
+
+        rNumPickers += rJobs.Num( );
+
+        for( const FJob& rJob : rJobs )
+        {
+            if( rJob.strIssue.IsEmpty( ) )
+            {
+                continue;
+            }
+
+            UE_LOG( LogComponentPicker, Warning, TEXT( "%s: %s.%s" ),
+                    *rJob.strIssue, *rJob.strReferencerPath, *rJob.strPropertyPath );
+
+            AddIssue( rMapPackage, rJob.strIssue, rJob.strReferencerPath, rJob.strPropertyPath,
+                      rJob.pComponent ? rJob.pComponent->GetPathName( ) : FString( ), rOutJsonIssues );
+        }
+
+        // The jobs point to components that may be unloaded once they are reported.
+        rJobs.Reset( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UComponentPickerValidationCommandlet::UComponentPickerValidationCommandlet( )
+{
+    IsClient = false;
+    IsEditor = true;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int32 UComponentPickerValidationCommandlet::Main( const FString& rParams )
+{
+    using namespace ComponentPickerValidation;
+
+    const bool bAllowEmpty = FParse::Param( *rParams, TEXT( "AllowEmpty" ) );
+
+    FString strReportPath = FPaths::ProjectSavedDir( ) / TEXT( "ComponentPicker/ValidationReport.json" );
+    FParse::Value( *rParams, TEXT( "Report=" ), strReportPath );
+
+    TArray<FString> oMapPackages;
+    FString strMaps;
+
+    if( FParse::Value( *rParams, TEXT( "Maps=" ), strMaps, false ) )
+    {
+        strMaps.ParseIntoArray( oMapPackages, TEXT( "+" ) );
+    }
+    else
+    {
+        IAssetRegistry& rAssetRegistry =
+            FModuleManager::LoadModuleChecked<FAssetRegistryModule>( "AssetRegistry" ).Get( );
+        rAssetRegistry.SearchAllAssets( true );
+
+        TArray<FAssetData> oWorldAssets;
+        rAssetRegistry.GetAssetsByClass( UWorld::StaticClass( )->GetClassPathName( ), oWorldAssets );
+
+        for( const FAssetData& rWorldAsset : oWorldAssets )
+        {
+            oMapPackages.Add( rWorldAsset.PackageName.ToString( ) );
+        }
+    }
+
+    TArray<TSharedPtr<FJsonValue>> oJsonIssues;
+    int32 nNumPickers = 0;
+
+    for( const FString& rMapPackage : oMapPackages )
+    {
+        UPackage* pPackage = LoadPackage( nullptr, *rMapPackage, LOAD_None );
+        UWorld* pWorld = pPackage ? UWorld::FindWorldInPackage( pPackage ) : nullptr;
+
+        if( pWorld == nullptr )
+        {
+            UE_LOG( LogComponentPicker, Error, TEXT( "Could not load map %s" ), *rMapPackage );
+
+            TSharedRef<FJsonObject> pJsonIssue = MakeShared<FJsonObject>( );
+            pJsonIssue->SetStringField( TEXT( "Map" ), rMapPackage );
+            pJsonIssue->SetStringField( TEXT( "Issue" ), TEXT( "LoadFailed" ) );
+            oJsonIssues.Add( MakeShared<FJsonValueObject>( pJsonIssue ) );
+            continue;
+        }
+
+        // Sub-levels are needed to validate the pickers targeting components of other levels.
+        pWorld->AddToRoot( );
+        pWorld->InitWorld( UWorld::InitializationValues( ).AllowAudioPlayback( false ).CreatePhysicsScene( false ) );
+        pWorld->LoadSecondaryLevels( );
+
+        TArray<FJob> oJobs;
+        TSet<FGuid> oGatheredActors;
+        GatherJobs( pWorld, oJobs, oGatheredActors );
+        ValidateAndReportJobs( rMapPackage, oJobs, bAllowEmpty, nNumPickers, oJsonIssues );
+
+        // World Partition actors are not loaded with the map. They are loaded in batches, with the actors they
+        // reference so that their pickers resolve, and the jobs are validated before each batch is released.
+        UWorldPartition* pWorldPartition = pWorld->GetWorldPartition( );
+        const bool bInitializeWorldPartition = pWorldPartition && !pWorldPartition->IsInitialized( );
+
+        if( bInitializeWorldPartition )
+        {
+            pWorldPartition->Initialize( pWorld, FTransform::Identity );
+        }
+
+        if( pWorldPartition )
+        {
+            FWorldPartitionHelpers::ForEachActorWithLoading( pWorldPartition, AActor::StaticClass( ),
+                [&]( const FWorldPartitionActorDesc* pActorDesc )
+                {
+                    if( oGatheredActors.Contains( pActorDesc->GetGuid( ) ) )
+                    {
+                        return true;
+                    }
+
+                    if( AActor* pActor = pActorDesc->GetActor( ) )
+                    {
+                        GatherJobs( pActor, oJobs );
+                    }
+                    else
+                    {
+                        UE_LOG( LogComponentPicker, Error, TEXT( "Could not load actor %s of map %s" ),
+                                *pActorDesc->GetActorPath( ).ToString( ), *rMapPackage );
+
+                        AddIssue( rMapPackage, TEXT( "LoadFailed" ), pActorDesc->GetActorPath( ).ToString( ),
+                                  FString( ), FString( ), oJsonIssues );
+                    }
+
+                    return true;
+                },
+                [&]( )
+                {
+                    ValidateAndReportJobs( rMapPackage, oJobs, bAllowEmpty, nNumPickers, oJsonIssues );
+                } );
+
+            ValidateAndReportJobs( rMapPackage, oJobs, bAllowEmpty, nNumPickers, oJsonIssues );
+        }
+
+        if( bInitializeWorldPartition )
+        {
+            pWorldPartition->Uninitialize( );
+        }
+
+        // Unload the map before loading the next one so that the memory used does not grow with the number of maps.
+        pWorld->RemoveFromRoot( );
+        pWorld->DestroyWorld( false );
+        CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+    }
+
+    TSharedRef<FJsonObject> pJsonReport = MakeShared<FJsonObject>( );
+    pJsonReport->SetNumberField( TEXT( "NumMaps" ), oMapPackages.Num( ) );
+    pJsonReport->SetNumberField( TEXT( "NumPickers" ), nNumPickers );
+    pJsonReport->SetArrayField( TEXT( "Issues" ), oJsonIssues );
+
+    FString strReport;
+    const TSharedRef<TJsonWriter<>> pJsonWriter = TJsonWriterFactory<>::Create( &strReport );
+    FJsonSerializer::Serialize( pJsonReport, pJsonWriter );
+
+    if( !FFileHelper::SaveStringToFile( strReport, *strReportPath ) )
+    {
+        UE_LOG( LogComponentPicker, Error, TEXT( "Could not write the report to %s" ), *strReportPath );
+        return 2;
+    }
+
+    UE_LOG( LogComponentPicker, Display, TEXT( "%d issue(s) in %d picker(s) over %d map(s), report written to %s" ),
+            oJsonIssues.Num( ), nNumPickers, oMapPackages.Num( ), *strReportPath );
+
+    return oJsonIssues.Num( ) > 0 ? 1 : 0;
+}
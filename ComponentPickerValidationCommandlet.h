@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "ComponentPickerValidationCommandlet.generated.h"
+
+// Headless check of every FComponentPicker of the project maps, meant to run on CI:
+//
+//   UnrealEditor-Cmd.exe <Project> -run=ComponentPickerValidation [-Maps=/Game/A+/Game/B] [-Report=<File>]
+//                        [-AllowEmpty]
+//
+// Maps are loaded one at a time and unloaded before the next one, the actors of World Partition maps are loaded in
+// batches with the actors they reference. The pickers are validated with the rules of the details panel: empty
+// values, values whose component can't be found, and values that the picker would refuse (other actor or level,
+// AllowedClasses/DisallowedClasses metadata) are written to a JSON report. Returns 1 if any issue was found.
+UCLASS( )
+class UComponentPickerValidationCommandlet : public UCommandlet
+{
+    GENERATED_BODY( )
+
+public:
+    UComponentPickerValidationCommandlet( );
+
+    // START UCommandlet interface.
+    virtual int32 Main( const FString& rParams ) override;
+    // END UCommandlet interface.
+};
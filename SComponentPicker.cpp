@@ -2,144 +2,873 @@
 
 #include "SComponentPicker.h"
 
-#include "Editor/SceneOutliner/Public/SceneOutlinerModule.h"
+#include "ComponentPicker.h"
+#include "ComponentPickerRecents.h"
+#include "ComponentPickerStats.h"
+
+#include "Async/Async.h"
 #include "HAL/PlatformApplicationMisc.h"
-#include "ActorTreeItem.h"
-#include "ComponentTreeItem.h"
+#include "Kismet2/ComponentEditorUtils.h"
+#include "Styling/SlateIconFinder.h"
+#include "Widgets/Input/SButton.h"
+#include "Widgets/Input/SCheckBox.h"
+#include "Widgets/Input/SSearchBox.h"
+
+// Number of items added synchronously when the population starts, enough to fill the first screen of the list.
+static const int32 PopulationFirstSliceItemCount = 32;
+
+// Time in seconds the population is allowed to take per frame.
+static const double PopulationSliceBudget = 0.001;
+
+// Maximum number of items listed for a search.
+static const int32 SearchMaxResults = 2000;
 
 #define LOCTEXT_NAMESPACE "SComponentPicker"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void SComponentPicker::Construct( const FArguments& rInArgs )
 {
+    COMPONENT_PICKER_SCOPE( Construct );
+
     m_pInitialComponent = rInArgs._pInitialComponent;
+    m_pOwnerActor = rInArgs._pOwnerActor;
     m_bAllowClear = rInArgs._bAllowClear;
+    m_bAllowAnyActor = rInArgs._bAllowAnyActor;
+    m_bMultiSelect = rInArgs._bMultiSelect;
+
+    // Checking components of unloaded actors would load all of them.
+    m_bAllowUnloadedActors = rInArgs._bAllowUnloadedActors && !m_bMultiSelect;
     m_oActorFilter = rInArgs._oActorFilter;
     m_oComponentFilter = rInArgs._oComponentFilter;
+    m_oUnloadedActorClassFilter = rInArgs._oUnloadedActorClassFilter;
+    m_oUnloadedComponentClassFilter = rInArgs._oUnloadedComponentClassFilter;
+    m_pCandidateSet = rInArgs._pCandidateSet;
     m_oOnSet = rInArgs._oOnSet;
+    m_oOnSetMultiple = rInArgs._oOnSetMultiple;
     m_oOnClose = rInArgs._oOnClose;
 
+    for( UActorComponent* pComponent : rInArgs._oInitialComponents )
+    {
+        if( pComponent )
+        {
+            m_oCheckedComponents.Add( pComponent );
+        }
+    }
+
     FMenuBuilder MenuBuilder( true, NULL );
 
-    MenuBuilder.BeginSection( NAME_None, LOCTEXT( "CurrentComponentOperationsHeader", "Current Component" ) );
+    // A single component is edited by the current component entries, several by the buttons under the list.
+    if( !m_bMultiSelect )
     {
-        if( m_pInitialComponent )
+        MenuBuilder.BeginSection( NAME_None, LOCTEXT( "CurrentComponentOperationsHeader", "Current Component" ) );
         {
+            if( m_pInitialComponent )
+            {
+                MenuBuilder.AddMenuEntry(
+                    LOCTEXT( "EditComponent", "Edit" ),
+                    LOCTEXT( "EditComponent_Tooltip", "Edit this component" ),
+                    FSlateIcon( ),
+                    FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnEdit ) ) );
+
+                MenuBuilder.AddMenuEntry(
+                    FComponentPickerRecents::Get( ).IsPinned( m_pInitialComponent )
+                        ? LOCTEXT( "UnpinComponent", "Unpin" )
+                        : LOCTEXT( "PinComponent", "Pin" ),
+                    LOCTEXT( "PinComponent_Tooltip", "Pins this component above the browse list of every picker" ),
+                    FSlateIcon( ),
+                    FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnTogglePinned ) ) );
+            }
+
             MenuBuilder.AddMenuEntry(
-                LOCTEXT( "EditComponent", "Edit" ),
-                LOCTEXT( "EditComponent_Tooltip", "Edit this component" ),
+                LOCTEXT( "CopyComponent", "Copy" ),
+                LOCTEXT( "CopyComponent_Tooltip", "Copies the component to the clipboard" ),
                 FSlateIcon( ),
-                FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnEdit ) ) );
-        }
+                FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnCopy ) )
+            );
 
-        MenuBuilder.AddMenuEntry(
-            LOCTEXT( "CopyComponent", "Copy" ),
-            LOCTEXT( "CopyComponent_Tooltip", "Copies the component to the clipboard" ),
-            FSlateIcon( ),
-            FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnCopy ) )
-        );
-
-        MenuBuilder.AddMenuEntry(
-            LOCTEXT( "PasteComponent", "Paste" ),
-            LOCTEXT( "PasteComponent_Tooltip", "Pastes an component from the clipboard to this field" ),
-            FSlateIcon( ),
-            FUIAction(
-                FExecuteAction::CreateSP( this, &SComponentPicker::OnPaste ),
-                FCanExecuteAction::CreateSP( this, &SComponentPicker::CanPaste ) )
-        );
-
-        if( m_bAllowClear )
-        {
             MenuBuilder.AddMenuEntry(
-                LOCTEXT( "ClearComponent", "Clear" ),
-                LOCTEXT( "ClearComponent_ToolTip", "Clears the component set on this field" ),
+                LOCTEXT( "PasteComponent", "Paste" ),
+                LOCTEXT( "PasteComponent_Tooltip", "Pastes an component from the clipboard to this field" ),
                 FSlateIcon( ),
-                FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnClear ) )
+                FUIAction(
+                    FExecuteAction::CreateSP( this, &SComponentPicker::OnPaste ),
+                    FCanExecuteAction::CreateSP( this, &SComponentPicker::CanPaste ) )
             );
+
+            if( m_bAllowClear )
+            {
+                MenuBuilder.AddMenuEntry(
+                    LOCTEXT( "ClearComponent", "Clear" ),
+                    LOCTEXT( "ClearComponent_ToolTip", "Clears the component set on this field" ),
+                    FSlateIcon( ),
+                    FUIAction( FExecuteAction::CreateSP( this, &SComponentPicker::OnClear ) )
+                );
+            }
         }
+        MenuBuilder.EndSection( );
+
+        // The common picks are available before the browse list has been populated.
+        AddRecentSection( MenuBuilder );
     }
-    MenuBuilder.EndSection( );
 
     MenuBuilder.BeginSection( NAME_None, LOCTEXT( "BrowseHeader", "Browse" ) );
     {
         TSharedPtr<SWidget> MenuContent;
 
-        FSceneOutlinerModule& SceneOutlinerModule =
-            FModuleManager::Get( ).LoadModuleChecked<FSceneOutlinerModule>( TEXT( "SceneOutliner" ) );
+        // NOTE: Copied these constant width and height overrides from
+        // Engine\Source\Editor\PropertyEditor\Private\UserInterface\PropertyEditor\PropertyEditorAssetConstants.h
+        MenuContent = SNew( SBox )
+            .WidthOverride( 300.0f )
+            .HeightOverride( 300.0f )
+            [
+                SNew( SBorder )
+                .BorderImage( FEditorStyle::GetBrush( "Menu.Background" ) )
+            [
+                BuildBrowseList( )
+            ]
+            ];
+
+        MenuBuilder.AddWidget( MenuContent.ToSharedRef( ), FText::GetEmpty( ), true );
+
+    }
+    MenuBuilder.EndSection( );
+
+    ChildSlot
+        [
+            MenuBuilder.MakeWidget( )
+        ];
+}
 
-        FSceneOutlinerInitializationOptions InitOptions;
-        InitOptions.bFocusSearchBoxWhenOpened = true;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::AddRecentSection( FMenuBuilder& rMenuBuilder )
+{
+    TArray<UActorComponent*> oPinned;
+    TArray<UActorComponent*> oRecent;
+    FComponentPickerRecents::Get( ).GetComponents( oPinned, oRecent );
 
-        struct FPickerFilter : public FSceneOutlinerFilter
+    // Both lists are bounded, so this costs a few filter calls whatever the size of the level.
+    auto oRemoveFiltered = [this]( TArray<UActorComponent*>& rComponents )
+    {
+        rComponents.RemoveAll( [this]( const UActorComponent* pComponent )
         {
-            FPickerFilter( const FOnShouldFilterActor& InActorFilter, const FOnShouldFilterComponent& InComponentFilter )
-                : FSceneOutlinerFilter( FSceneOutlinerFilter::EDefaultBehaviour::Fail )
-                , ActorFilter( InActorFilter )
-                , ComponentFilter( InComponentFilter )
+            return !IsInScope( pComponent ) || !PassesFilter( pComponent );
+        } );
+    };
+
+    oRemoveFiltered( oPinned );
+    oRemoveFiltered( oRecent );
+
+    if( oPinned.Num( ) == 0 && oRecent.Num( ) == 0 )
+    {
+        return;
+    }
+
+    auto oAddEntries = [&]( const TArray<UActorComponent*>& rComponents, const FText& rTooltip )
+    {
+        for( UActorComponent* pComponent : rComponents )
+        {
+            TWeakObjectPtr<UActorComponent> pWeakComponent = pComponent;
+
+            rMenuBuilder.AddMenuEntry(
+                GetComponentLabel( pComponent, m_bAllowAnyActor ),
+                rTooltip,
+                FSlateIconFinder::FindIconForClass( pComponent->GetClass( ) ),
+                FUIAction( FExecuteAction::CreateSPLambda( this, [this, pWeakComponent]( )
+                {
+                    if( UActorComponent* pResolvedComponent = pWeakComponent.Get( ) )
+                    {
+                        OnItemSelected( pResolvedComponent );
+                    }
+                } ) ) );
+        }
+    };
+
+    rMenuBuilder.BeginSection( NAME_None, LOCTEXT( "RecentHeader", "Pinned & Recent" ) );
+    {
+        oAddEntries( oPinned, LOCTEXT( "PinnedItem_Tooltip", "Pinned component" ) );
+        oAddEntries( oRecent, LOCTEXT( "RecentItem_Tooltip", "Recently picked component" ) );
+    }
+    rMenuBuilder.EndSection( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<SWidget> SComponentPicker::BuildBrowseList( )
+{
+    PopulateItems( );
+
+    // Focus the search box as soon as the menu is displayed.
+    RegisterActiveTimer( 0.0f, FWidgetActiveTimerDelegate::CreateLambda( [this]( double, float )
+    {
+        FSlateApplication::Get( ).SetKeyboardFocus( m_pSearchBox, EFocusCause::SetDirectly );
+        return EActiveTimerReturnType::Stop;
+    } ) );
+
+    TSharedRef<SVerticalBox> pBrowseList = SNew( SVerticalBox )
+        + SVerticalBox::Slot( )
+        .AutoHeight( )
+        .Padding( 2.0f )
+        [
+            SAssignNew( m_pSearchBox, SSearchBox )
+            .OnTextChanged( this, &SComponentPicker::OnSearchTextChanged )
+        ]
+        + SVerticalBox::Slot( )
+        .FillHeight( 1.0f )
+        [
+            SAssignNew( m_pListView, SListView<FPickerItemPtr> )
+            .ListItemsSource( &m_oVisibleItems )
+            .SelectionMode( ESelectionMode::Single )
+            .OnGenerateRow( this, &SComponentPicker::OnGenerateRow )
+            .OnSelectionChanged( this, &SComponentPicker::OnSelectionChanged )
+            .OnMouseButtonClick( this, &SComponentPicker::OnItemClicked )
+        ];
+
+    if( m_bMultiSelect )
+    {
+        pBrowseList->AddSlot( )
+            .AutoHeight( )
+            .Padding( 2.0f )
+            [
+                BuildMultiSelectBar( )
+            ];
+    }
+
+    return pBrowseList;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::PopulateItems( )
+{
+    // Every candidate of a prewarmed set passed the filters already, and its search index is ready.
+    if( m_pCandidateSet.IsValid( ) )
+    {
+        m_oCandidates = m_pCandidateSet->oComponents;
+        m_oCandidateItems.Reset( );
+        m_oCandidateItems.SetNum( m_oCandidates.Num( ) );
+        m_oEvaluatedCandidates.Init( false, m_oCandidates.Num( ) );
+
+        m_oSearchEntries.Reset( );
+        m_pSearchIndex = m_pCandidateSet->pSearchIndex;
+        m_bSearchIndexRequested = true;
+
+        m_oUnloadedWalk = FComponentPickerUnloadedWalk( );
+        m_oUnloadedWalk.bDone = true;
+
+        StartPopulation( );
+        return;
+    }
+
+    // The picker can only show components of the owner actor, or of the actors in the same level.
+    TArray<UActorComponent*> oCandidates;
+    const AActor* pOwnerActor = m_pOwnerActor.Get( );
+
+    if( m_bAllowAnyActor )
+    {
+        FComponentPickerIndex::Get( ).GetComponents( pOwnerActor ? pOwnerActor->GetLevel( ) : nullptr, oCandidates );
+    }
+    else
+    {
+        FComponentPickerIndex::Get( ).GetComponents( pOwnerActor, oCandidates );
+    }
+
+    m_oCandidates.Reset( oCandidates.Num( ) );
+
+    for( UActorComponent* pComponent : oCandidates )
+    {
+        m_oCandidates.Add( pComponent );
+    }
+
+    m_oCandidateItems.Reset( );
+    m_oCandidateItems.SetNum( m_oCandidates.Num( ) );
+    m_oEvaluatedCandidates.Init( false, m_oCandidates.Num( ) );
+
+    m_oSearchEntries.Reset( );
+    m_pSearchIndex.Reset( );
+    m_bSearchIndexRequested = false;
+
+    m_oUnloadedWalk = FComponentPickerUnloadedWalk( );
+    m_oUnloadedWalk.pWorld = pOwnerActor ? pOwnerActor->GetWorld( ) : nullptr;
+    m_oUnloadedWalk.bDone = !m_bAllowAnyActor || !m_bAllowUnloadedActors;
+
+    StartPopulation( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::AddUnloadedCandidates( double fEndTime )
+{
+    TArray<FComponentPickerUnloadedComponent> oUnloadedComponents;
+
+    FComponentPickerIndex::Get( ).GetUnloadedComponents(
+        m_oUnloadedWalk,
+        fEndTime,
+        [this]( const UClass* pActorClass )
+        {
+            return !m_oUnloadedActorClassFilter.IsBound( ) || m_oUnloadedActorClassFilter.Execute( pActorClass );
+        },
+        [this]( const UClass* pComponentClass )
+        {
+            return !m_oUnloadedComponentClassFilter.IsBound( ) ||
+                m_oUnloadedComponentClassFilter.Execute( pComponentClass );
+        },
+        oUnloadedComponents );
+
+    // The items are created right away, they have already been filtered on their class. The population lists them
+    // next, as any other candidate.
+    for( const FComponentPickerUnloadedComponent& rUnloadedComponent : oUnloadedComponents )
+    {
+        const int32 nCandidate = m_oCandidates.Add( nullptr );
+        m_oEvaluatedCandidates.Add( true );
+
+        FPickerItemPtr pItem = MakeShared<FPickerItem>( );
+        pItem->strLabel = FText::Format( LOCTEXT( "UnloadedItemLabel", "{0}.{1} (Unloaded)" ),
+                                         FText::AsCultureInvariant( rUnloadedComponent.strActorLabel ),
+                                         FText::FromName( rUnloadedComponent.strComponentName ) );
+        pItem->oUnloadedActorGuid = rUnloadedComponent.oActorGuid;
+        pItem->strUnloadedComponentName = rUnloadedComponent.strComponentName;
+        pItem->pUnloadedComponentClass = rUnloadedComponent.pComponentClass;
+        m_oCandidateItems.Add( pItem );
+
+        FComponentPickerSearchIndex::FEntry& rSearchEntry = m_oSearchEntries.AddDefaulted_GetRef( );
+        rSearchEntry.nId = nCandidate;
+        rSearchEntry.strActorLabel = rUnloadedComponent.strActorLabel;
+        rSearchEntry.strComponentName = rUnloadedComponent.strComponentName.ToString( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UActorComponent* SComponentPicker::LoadUnloadedComponent( const FPickerItem& rItem )
+{
+    const AActor* pOwnerActor = m_pOwnerActor.Get( );
+
+    AActor* pActor = FComponentPickerIndex::Get( ).LoadActor( pOwnerActor ? pOwnerActor->GetWorld( ) : nullptr,
+                                                              rItem.oUnloadedActorGuid );
+
+    return pActor ? FindObjectFast<UActorComponent>( pActor, rItem.strUnloadedComponentName ) : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::StartPopulation( )
+{
+    // Restarting cancels the pass in progress, the filter results of the candidates already evaluated are kept.
+    m_oVisibleItems.Reset( );
+    m_nNextCandidate = 0;
+    m_nPopulationFrames = 0;
+    m_fWorstPopulationSliceTime = 0.0;
+
+    // The first screenful is added right away so the menu never opens empty.
+    if( PopulateSlice( PopulationFirstSliceItemCount ) )
+    {
+        BuildSearchIndex( );
+    }
+    else if( !m_pPopulationTimer.IsValid( ) )
+    {
+        m_pPopulationTimer = RegisterActiveTimer(
+            0.0f, FWidgetActiveTimerDelegate::CreateSP( this, &SComponentPicker::OnPopulationTimer ) );
+    }
+
+    if( m_pListView.IsValid( ) )
+    {
+        m_pListView->RequestListRefresh( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SComponentPicker::PopulateSlice( int32 nMaxVisibleItems )
+{
+    const double fStartTime = FPlatformTime::Seconds( );
+    const FString& strSearchText = m_strSearchText.ToString( );
+    int32 nAddedItems = 0;
+
+    while( nAddedItems < nMaxVisibleItems )
+    {
+        // The World Partition actors that are not loaded come last, their descriptors are walked in the time left.
+        if( m_nNextCandidate >= m_oCandidates.Num( ) )
+        {
+            if( m_oUnloadedWalk.bDone )
             {
-                // Empty
+                break;
             }
 
-            virtual bool PassesFilter( const ISceneOutlinerTreeItem& InItem ) const override
+            AddUnloadedCandidates( fStartTime + PopulationSliceBudget );
+
+            if( FPlatformTime::Seconds( ) - fStartTime > PopulationSliceBudget )
             {
-                if( const FActorTreeItem* ActorItem = InItem.CastTo<FActorTreeItem>( ) )
-                {
-                    return ActorItem->IsValid( ) && ActorFilter.Execute( ActorItem->Actor.Get( ) );
-                }
-                else if( const FComponentTreeItem* ComponentItem = InItem.CastTo<FComponentTreeItem>( ) )
+                break;
+            }
+
+            continue;
+        }
+
+        const int32 nCandidate = m_nNextCandidate++;
+
+        if( !m_oEvaluatedCandidates[nCandidate] )
+        {
+            m_oEvaluatedCandidates[nCandidate] = true;
+
+            const UActorComponent* pComponent = m_oCandidates[nCandidate].Get( );
+
+            if( m_pCandidateSet.IsValid( ) )
+            {
+                // Only the list item is left to create.
+                if( IsValid( pComponent ) )
                 {
-                    return ComponentItem->IsValid( ) && ComponentFilter.Execute( ComponentItem->Component.Get( ) );
+                    FPickerItemPtr pItem = MakeShared<FPickerItem>( );
+                    pItem->pComponent = m_oCandidates[nCandidate];
+                    pItem->strLabel = m_pCandidateSet->oLabels[nCandidate];
+
+                    m_oCandidateItems[nCandidate] = pItem;
                 }
+            }
+            else if( PassesFilter( pComponent ) )
+            {
+                FPickerItemPtr pItem = MakeShared<FPickerItem>( );
+                pItem->pComponent = m_oCandidates[nCandidate];
+                pItem->strLabel = GetComponentLabel( pComponent, m_bAllowAnyActor );
+
+                m_oCandidateItems[nCandidate] = pItem;
 
-                return DefaultBehaviour == FSceneOutlinerFilter::EDefaultBehaviour::Pass;
+                FComponentPickerSearchIndex::FEntry& rSearchEntry = m_oSearchEntries.AddDefaulted_GetRef( );
+                GetSearchEntry( pComponent, m_bAllowAnyActor, rSearchEntry );
+                rSearchEntry.nId = nCandidate;
             }
+        }
+
+        const FPickerItemPtr& pItem = m_oCandidateItems[nCandidate];
+
+        if( pItem.IsValid( ) && ( strSearchText.IsEmpty( ) || pItem->strLabel.ToString( ).Contains( strSearchText ) ) )
+        {
+            m_oVisibleItems.Add( pItem );
+            ++nAddedItems;
+        }
+
+        if( FPlatformTime::Seconds( ) - fStartTime > PopulationSliceBudget )
+        {
+            break;
+        }
+    }
+
+    m_fWorstPopulationSliceTime = FMath::Max( m_fWorstPopulationSliceTime, FPlatformTime::Seconds( ) - fStartTime );
+
+    return m_nNextCandidate >= m_oCandidates.Num( ) && m_oUnloadedWalk.bDone;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EActiveTimerReturnType SComponentPicker::OnPopulationTimer( double fCurrentTime, float fDeltaTime )
+{
+    ++m_nPopulationFrames;
+
+    const bool bDone = PopulateSlice( MAX_int32 );
+
+    if( m_pListView.IsValid( ) )
+    {
+        m_pListView->RequestListRefresh( );
+    }
+
+    if( bDone )
+    {
+        UE_LOG( LogComponentPicker,
+                Verbose,
+                TEXT( "Populated %d items out of %d candidates in %d frame(s), worst slice took %.3f ms." ),
+                m_oVisibleItems.Num( ),
+                m_oCandidates.Num( ),
+                m_nPopulationFrames,
+                m_fWorstPopulationSliceTime * 1000.0 );
+
+        m_pPopulationTimer.Reset( );
+        BuildSearchIndex( );
+        return EActiveTimerReturnType::Stop;
+    }
 
-            virtual bool GetInteractiveState( const ISceneOutlinerTreeItem& InItem ) const override
+    return EActiveTimerReturnType::Continue;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::BuildSearchIndex( )
+{
+    // Every candidate has been evaluated once the first population is done, later ones only filter the items.
+    if( m_bSearchIndexRequested )
+    {
+        return;
+    }
+
+    m_bSearchIndexRequested = true;
+
+    TWeakPtr<SComponentPicker> pWeakThis = SharedThis( this );
+
+    Async( EAsyncExecution::ThreadPool, [pWeakThis, oSearchEntries = MoveTemp( m_oSearchEntries )]( ) mutable
+    {
+        const double fStartTime = FPlatformTime::Seconds( );
+
+        TSharedPtr<const FComponentPickerSearchIndex, ESPMode::ThreadSafe> pSearchIndex =
+            MakeShared<const FComponentPickerSearchIndex, ESPMode::ThreadSafe>( MoveTemp( oSearchEntries ) );
+
+        UE_LOG( LogComponentPicker,
+                Verbose,
+                TEXT( "Built the search index of %d items in %.3f ms." ),
+                pSearchIndex->Num( ),
+                ( FPlatformTime::Seconds( ) - fStartTime ) * 1000.0 );
+
+        AsyncTask( ENamedThreads::GameThread, [pWeakThis, pSearchIndex]( )
+        {
+            if( TSharedPtr<SComponentPicker> pThis = pWeakThis.Pin( ) )
             {
-                // All components which pass the filter are interactive
-                if( const FComponentTreeItem* ComponentItem = InItem.CastTo<FComponentTreeItem>( ) )
-                {
-                    return true;
-                }
+                pThis->OnSearchIndexBuilt( pSearchIndex );
+            }
+        } );
+    } );
+
+    m_oSearchEntries.Reset( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::OnSearchIndexBuilt(
+    TSharedPtr<const FComponentPickerSearchIndex, ESPMode::ThreadSafe> pSearchIndex )
+{
+    m_pSearchIndex = pSearchIndex;
+
+    // Rank the items of the search typed while the index was being built.
+    if( !m_strSearchText.IsEmpty( ) )
+    {
+        StartSearchQuery( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::StartSearchQuery( )
+{
+    const int32 nSearchGeneration = ++m_nSearchGeneration;
+    TWeakPtr<SComponentPicker> pWeakThis = SharedThis( this );
+
+    // Typing is never blocked, the list keeps the previous results until the query is done.
+    Async( EAsyncExecution::ThreadPool,
+           [pWeakThis, pSearchIndex = m_pSearchIndex, strQuery = m_strSearchText.ToString( ), nSearchGeneration]( )
+    {
+        TArray<int32> oCandidates;
+        pSearchIndex->Query( strQuery, SearchMaxResults, oCandidates );
 
-                return DefaultBehaviour == FSceneOutlinerFilter::EDefaultBehaviour::Pass;
+        AsyncTask( ENamedThreads::GameThread, [pWeakThis, nSearchGeneration, oCandidates = MoveTemp( oCandidates )]( )
+            mutable
+        {
+            if( TSharedPtr<SComponentPicker> pThis = pWeakThis.Pin( ) )
+            {
+                pThis->OnSearchQueryDone( nSearchGeneration, MoveTemp( oCandidates ) );
             }
+        } );
+    } );
+}
 
-            FOnShouldFilterActor ActorFilter;
-            FOnShouldFilterComponent ComponentFilter;
-        };
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::OnSearchQueryDone( int32 nSearchGeneration, TArray<int32>&& rCandidates )
+{
+    if( nSearchGeneration != m_nSearchGeneration )
+    {
+        return;
+    }
 
-        TSharedRef<FSceneOutlinerFilter> Filter = MakeShared<FPickerFilter>( m_oActorFilter, m_oComponentFilter );
-        InitOptions.Filters->Add( Filter );
+    m_oVisibleItems.Reset( rCandidates.Num( ) );
 
-        InitOptions.ColumnMap.Add( FSceneOutlinerBuiltInColumnTypes::Label( ),
-                                   FSceneOutlinerColumnInfo( ESceneOutlinerColumnVisibility::Visible, 0 ) );
+    for( int32 nCandidate : rCandidates )
+    {
+        if( m_oCandidateItems.IsValidIndex( nCandidate ) && m_oCandidateItems[nCandidate].IsValid( ) )
+        {
+            m_oVisibleItems.Add( m_oCandidateItems[nCandidate] );
+        }
+    }
 
-        // NOTE: Copied these constant width and height overrides from
-        // Engine\Source\Editor\PropertyEditor\Private\UserInterface\PropertyEditor\PropertyEditorAssetConstants.h
-        MenuContent = SNew( SBox )
-            .WidthOverride( 300.0f )
-            .HeightOverride( 300.0f )
-            [
-                SNew( SBorder )
-                .BorderImage( FEditorStyle::GetBrush( "Menu.Background" ) )
-            [
-                SceneOutlinerModule.CreateComponentPicker(
-                    InitOptions, FOnComponentPicked::CreateSP( this, &SComponentPicker::OnItemSelected ) )
-            ]
-            ];
+    if( m_pListView.IsValid( ) )
+    {
+        m_pListView->RequestListRefresh( );
+    }
+}
 
-        MenuBuilder.AddWidget( MenuContent.ToSharedRef( ), FText::GetEmpty( ), true );
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SComponentPicker::PassesFilter( const UActorComponent* pComponent ) const
+{
+    COMPONENT_PICKER_SCOPE( PassesFilter );
+
+    const bool bPassesFilter = pComponent &&
+        pComponent->GetOwner( ) &&
+        ( !m_oActorFilter.IsBound( ) || m_oActorFilter.Execute( pComponent->GetOwner( ) ) ) &&
+        ( !m_oComponentFilter.IsBound( ) || m_oComponentFilter.Execute( pComponent ) );
+
+    FComponentPickerStats::Increment( bPassesFilter ? FComponentPickerStats::ECounter::ItemsPassed
+                                                    : FComponentPickerStats::ECounter::ItemsFiltered );
 
+    return bPassesFilter;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SComponentPicker::IsInScope( const UActorComponent* pComponent ) const
+{
+    const AActor* pOwnerActor = m_pOwnerActor.Get( );
+    const AActor* pComponentOwner = pComponent ? pComponent->GetOwner( ) : nullptr;
+
+    if( pOwnerActor == nullptr || pComponentOwner == nullptr )
+    {
+        return false;
     }
-    MenuBuilder.EndSection( );
 
-    ChildSlot
+    return m_bAllowAnyActor ? pComponentOwner->GetLevel( ) == pOwnerActor->GetLevel( )
+                            : pComponentOwner == pOwnerActor;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FText SComponentPicker::GetComponentLabel( const UActorComponent* pComponent, bool bAllowAnyActor )
+{
+    return bAllowAnyActor
+        ? FText::Format( LOCTEXT( "ItemLabel", "{0}.{1}" ),
+                         FText::AsCultureInvariant( pComponent->GetOwner( )->GetActorLabel( ) ),
+                         FText::AsCultureInvariant( pComponent->GetName( ) ) )
+        : FText::AsCultureInvariant( pComponent->GetName( ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::GetSearchEntry( const UActorComponent* pComponent,
+                                       bool bAllowAnyActor,
+                                       FComponentPickerSearchIndex::FEntry& rOutSearchEntry )
+{
+    rOutSearchEntry.strComponentName = pComponent->GetName( );
+
+    if( bAllowAnyActor )
+    {
+        rOutSearchEntry.strActorLabel = pComponent->GetOwner( )->GetActorLabel( );
+    }
+
+    const FName strVariableName = FComponentEditorUtils::FindVariableNameGivenComponentInstance( pComponent );
+
+    if( !strVariableName.IsNone( ) && strVariableName != pComponent->GetFName( ) )
+    {
+        rOutSearchEntry.strVariableName = strVariableName.ToString( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<ITableRow> SComponentPicker::OnGenerateRow( FPickerItemPtr pItem,
+                                                       const TSharedRef<STableViewBase>& rOwnerTable )
+{
+    const UActorComponent* pComponent = pItem->pComponent.Get( );
+
+    return SNew( STableRow<FPickerItemPtr>, rOwnerTable )
         [
-            MenuBuilder.MakeWidget( )
+            SNew( SHorizontalBox )
+            + SHorizontalBox::Slot( )
+        .AutoWidth( )
+        .VAlign( VAlign_Center )
+        [
+            SNew( SCheckBox )
+            .Visibility( m_bMultiSelect && pComponent ? EVisibility::Visible : EVisibility::Collapsed )
+            .IsChecked_Lambda( [this, pItem]( )
+            {
+                return IsItemChecked( pItem ) ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+            } )
+            .OnCheckStateChanged_Lambda( [this, pItem]( ECheckBoxState eState )
+            {
+                SetItemChecked( pItem, eState == ECheckBoxState::Checked );
+                m_pLastClickedItem = pItem;
+            } )
+        ]
+        + SHorizontalBox::Slot( )
+        .AutoWidth( )
+        .VAlign( VAlign_Center )
+        .Padding( 0.0f, 0.0f, 4.0f, 0.0f )
+        [
+            SNew( SImage )
+            .Image( FSlateIconFinder::FindIconBrushForClass(
+                pComponent ? pComponent->GetClass( )
+                           : pItem->pUnloadedComponentClass ? pItem->pUnloadedComponentClass
+                                                            : UActorComponent::StaticClass( ) ) )
+        ]
+        + SHorizontalBox::Slot( )
+        .FillWidth( 1.0f )
+        .VAlign( VAlign_Center )
+        [
+            SNew( STextBlock )
+            .Text( pItem->strLabel )
+            .HighlightText_Lambda( [this]( ) { return m_strSearchText; } )
+        ]
         ];
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::OnSelectionChanged( FPickerItemPtr pItem, ESelectInfo::Type eSelectInfo )
+{
+    // In multi-select mode nothing is picked until the selection is applied.
+    if( !pItem.IsValid( ) || eSelectInfo == ESelectInfo::Direct || m_bMultiSelect )
+    {
+        return;
+    }
+
+    // Only the actor of the picked item is loaded.
+    if( pItem->oUnloadedActorGuid.IsValid( ) )
+    {
+        if( UActorComponent* pComponent = LoadUnloadedComponent( *pItem ) )
+        {
+            OnItemSelected( pComponent );
+        }
+        else
+        {
+            UE_LOG( LogComponentPicker, Warning, TEXT( "Could not load %s." ), *pItem->strLabel.ToString( ) );
+        }
+
+        return;
+    }
+
+    OnItemSelected( pItem->pComponent.Get( ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::OnSearchTextChanged( const FText& rSearchText )
+{
+    m_strSearchText = rSearchText;
+
+    // Until the search index is ready, the population matches the labels as substrings.
+    if( m_pSearchIndex.IsValid( ) && !m_strSearchText.IsEmpty( ) )
+    {
+        StartSearchQuery( );
+    }
+    else
+    {
+        ++m_nSearchGeneration;
+        StartPopulation( );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TSharedRef<SWidget> SComponentPicker::BuildMultiSelectBar( )
+{
+    return SNew( SHorizontalBox )
+        + SHorizontalBox::Slot( )
+        .FillWidth( 1.0f )
+        .VAlign( VAlign_Center )
+        [
+            SNew( STextBlock )
+            .Text_Lambda( [this]( )
+            {
+                return FText::Format( LOCTEXT( "CheckedCount", "{0} selected" ), m_oCheckedComponents.Num( ) );
+            } )
+        ]
+        + SHorizontalBox::Slot( )
+        .AutoWidth( )
+        [
+            SNew( SButton )
+            .Text( LOCTEXT( "CheckAllMatching", "All" ) )
+            .ToolTipText( LOCTEXT( "CheckAllMatching_Tooltip", "Selects every component matching the search" ) )
+            .OnClicked( this, &SComponentPicker::OnCheckAllMatching )
+        ]
+        + SHorizontalBox::Slot( )
+        .AutoWidth( )
+        [
+            SNew( SButton )
+            .Text( LOCTEXT( "UncheckAll", "None" ) )
+            .ToolTipText( LOCTEXT( "UncheckAll_Tooltip", "Clears the selection" ) )
+            .OnClicked( this, &SComponentPicker::OnUncheckAll )
+        ]
+        + SHorizontalBox::Slot( )
+        .AutoWidth( )
+        [
+            SNew( SButton )
+            .ButtonStyle( FEditorStyle::Get( ), "PrimaryButton" )
+            .Text( LOCTEXT( "ApplyChecked", "Apply" ) )
+            .ToolTipText( LOCTEXT( "ApplyChecked_Tooltip", "Replaces the elements of the array with the selection" ) )
+            .OnClicked( this, &SComponentPicker::OnApply )
+        ];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::OnItemClicked( FPickerItemPtr pItem )
+{
+    if( !m_bMultiSelect || !pItem.IsValid( ) )
+    {
+        return;
+    }
+
+    const FPickerItemPtr pLastClickedItem = m_pLastClickedItem.Pin( );
+    m_pLastClickedItem = pItem;
+
+    if( pLastClickedItem.IsValid( ) && FSlateApplication::Get( ).GetModifierKeys( ).IsShiftDown( ) )
+    {
+        const int32 nFirst = m_oVisibleItems.IndexOfByKey( pLastClickedItem );
+        const int32 nLast = m_oVisibleItems.IndexOfByKey( pItem );
+
+        if( nFirst != INDEX_NONE && nLast != INDEX_NONE )
+        {
+            const bool bChecked = IsItemChecked( pLastClickedItem );
+
+            for( int32 nItem = FMath::Min( nFirst, nLast ); nItem <= FMath::Max( nFirst, nLast ); ++nItem )
+            {
+                SetItemChecked( m_oVisibleItems[nItem], bChecked );
+            }
+
+            return;
+        }
+    }
+
+    SetItemChecked( pItem, !IsItemChecked( pItem ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SComponentPicker::IsItemChecked( const FPickerItemPtr& pItem ) const
+{
+    return m_oCheckedComponents.Contains( pItem->pComponent );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::SetItemChecked( const FPickerItemPtr& pItem, bool bChecked )
+{
+    // Items of unloaded actors have no component and can't be checked.
+    if( !pItem->pComponent.IsValid( ) )
+    {
+        return;
+    }
+
+    if( bChecked )
+    {
+        m_oCheckedComponents.Add( pItem->pComponent );
+    }
+    else
+    {
+        m_oCheckedComponents.Remove( pItem->pComponent );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FReply SComponentPicker::OnCheckAllMatching( )
+{
+    for( const FPickerItemPtr& pItem : m_oVisibleItems )
+    {
+        SetItemChecked( pItem, true );
+    }
+
+    return FReply::Handled( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FReply SComponentPicker::OnUncheckAll( )
+{
+    m_oCheckedComponents.Reset( );
+
+    return FReply::Handled( );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FReply SComponentPicker::OnApply( )
+{
+    TArray<UActorComponent*> oComponents;
+    oComponents.Reserve( m_oCheckedComponents.Num( ) );
+
+    for( const TWeakObjectPtr<UActorComponent>& pComponent : m_oCheckedComponents )
+    {
+        if( UActorComponent* pResolvedComponent = pComponent.Get( ) )
+        {
+            oComponents.Add( pResolvedComponent );
+        }
+    }
+
+    m_oOnSetMultiple.ExecuteIfBound( oComponents );
+    m_oOnClose.ExecuteIfBound( );
+
+    return FReply::Handled( );
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void SComponentPicker::OnEdit( )
 {
@@ -151,6 +880,15 @@ void SComponentPicker::OnEdit( )
     m_oOnClose.ExecuteIfBound( );
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SComponentPicker::OnTogglePinned( )
+{
+    FComponentPickerRecents& rRecents = FComponentPickerRecents::Get( );
+    rRecents.SetPinned( m_pInitialComponent, !rRecents.IsPinned( m_pInitialComponent ) );
+
+    m_oOnClose.ExecuteIfBound( );
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void SComponentPicker::OnCopy( )
 {
@@ -167,33 +905,18 @@ void SComponentPicker::OnCopy( )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void SComponentPicker::OnPaste( )
 {
-    FString ClipboardText;
-    FPlatformApplicationMisc::ClipboardPaste( ClipboardText );
-
     bool bFound = false;
 
-    int32 SpaceIndex = INDEX_NONE;
+    UActorComponent* Component = GetClipboardComponent( );
 
-    if( ClipboardText.FindChar( TEXT( ' ' ), SpaceIndex ) )
+    if( Component &&
+        Component->GetOwner( ) &&
+        ( !m_oComponentFilter.IsBound( ) || m_oComponentFilter.Execute( Component ) ) )
     {
-        FString ClassPath = ClipboardText.Left( SpaceIndex );
-        FString PossibleObjectPath = ClipboardText.Mid( SpaceIndex );
-
-        if( UClass* ClassPtr = LoadClass<UActorComponent>( nullptr, *ClassPath ) )
+        if( !m_oActorFilter.IsBound( ) || m_oActorFilter.Execute( Component->GetOwner( ) ) )
         {
-            UActorComponent* Component = FindObject<UActorComponent>( nullptr, *PossibleObjectPath );
-
-            if( Component &&
-                Component->IsA( ClassPtr ) &&
-                Component->GetOwner( ) &&
-                ( !m_oComponentFilter.IsBound( ) || m_oComponentFilter.Execute( Component ) ) )
-            {
-                if( !m_oActorFilter.IsBound( ) || m_oActorFilter.Execute( Component->GetOwner( ) ) )
-                {
-                    SetValue( Component );
-                    bFound = true;
-                }
-            }
+            SetValue( Component );
+            bFound = true;
         }
     }
 
@@ -208,32 +931,52 @@ void SComponentPicker::OnPaste( )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool SComponentPicker::CanPaste( )
 {
-    FString ClipboardText;
-    FPlatformApplicationMisc::ClipboardPaste( ClipboardText );
+    return GetClipboardComponent( ) != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UActorComponent* SComponentPicker::GetClipboardComponent( )
+{
+    FString strClipboardText;
+    FPlatformApplicationMisc::ClipboardPaste( strClipboardText );
+
+    // A miss isn't cached: the copied component may be loaded, or created again, while the text stays the same.
+    if( UActorComponent* pClipboardComponent = m_pClipboardComponent.Get( ) )
+    {
+        if( strClipboardText.Equals( m_strClipboardText, ESearchCase::CaseSensitive ) )
+        {
+            return pClipboardComponent;
+        }
+    }
 
-    bool bCanPaste = false;
+    m_strClipboardText = strClipboardText;
+    m_pClipboardComponent.Reset( );
 
-    int32 SpaceIndex = INDEX_NONE;
+    // The text is written by OnCopy: "<class path> <component path>".
+    int32 nSpaceIndex = INDEX_NONE;
 
-    if( ClipboardText.FindChar( TEXT( ' ' ), SpaceIndex ) )
+    if( !strClipboardText.FindChar( TEXT( ' ' ), nSpaceIndex ) )
     {
-        FString Class = ClipboardText.Left( SpaceIndex );
-        FString PossibleObjectPath = ClipboardText.Mid( SpaceIndex );
+        return nullptr;
+    }
 
-        bCanPaste = !Class.IsEmpty( ) && !PossibleObjectPath.IsEmpty( );
+    const FString strClassPath = strClipboardText.Left( nSpaceIndex );
+    const FString strObjectPath = strClipboardText.Mid( nSpaceIndex + 1 ).TrimStartAndEnd( );
 
-        if( bCanPaste )
-        {
-            bCanPaste = LoadClass<UActorComponent>( nullptr, *Class ) != nullptr;
-        }
+    if( strClassPath.IsEmpty( ) || strObjectPath.IsEmpty( ) )
+    {
+        return nullptr;
+    }
 
-        if( bCanPaste )
-        {
-            bCanPaste = FindObject<UActorComponent>( nullptr, *PossibleObjectPath ) != nullptr;
-        }
+    const UClass* pClass = FindObject<UClass>( nullptr, *strClassPath );
+    UActorComponent* pComponent = pClass ? FindObject<UActorComponent>( nullptr, *strObjectPath ) : nullptr;
+
+    if( pComponent && pComponent->IsA( pClass ) )
+    {
+        m_pClipboardComponent = pComponent;
     }
 
-    return bCanPaste;
+    return m_pClipboardComponent.Get( );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -253,6 +996,7 @@ void SComponentPicker::OnItemSelected( UActorComponent* pComponent )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void SComponentPicker::SetValue( UActorComponent* pInComponent )
 {
+    FComponentPickerRecents::Get( ).AddRecent( pInComponent );
     m_oOnSet.ExecuteIfBound( pInComponent );
 }
 
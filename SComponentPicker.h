@@ -2,43 +2,146 @@
 
 #pragma once
 
+#include "ComponentPickerCandidateCache.h"
+#include "ComponentPickerIndex.h"
+#include "ComponentPickerSearchIndex.h"
+
 #include "PropertyCustomizationHelpers.h"
+#include "Widgets/Views/SListView.h"
 
+class AActor;
+class ITableRow;
+class SSearchBox;
+class STableViewBase;
 class UActorComponent;
 
 DECLARE_DELEGATE_OneParam( FOnComponentPicked, UActorComponent* );
-
-namespace SceneOutliner
-{
-    struct ISceneOutlinerTreeItem;
-}
+DECLARE_DELEGATE_OneParam( FOnComponentsPicked, const TArray<UActorComponent*>& );
+DECLARE_DELEGATE_RetVal_OneParam( bool, FOnShouldFilterClass, const UClass* );
 
 // Essentially a duplicate of SPropertyMenuComponentPicker. A widget that allows picking components from the scene.
+// Instead of building a scene outliner, the candidates are read from the FComponentPickerIndex.
 class SComponentPicker : public SCompoundWidget
 {
 public:
     SLATE_BEGIN_ARGS( SComponentPicker )
         : _pInitialComponent( nullptr )
+        , _pOwnerActor( nullptr )
         , _bAllowClear( true )
+        , _bAllowAnyActor( false )
+        , _bAllowUnloadedActors( false )
+        , _bMultiSelect( false )
         , _oActorFilter( )
     {
     }
 
     SLATE_ARGUMENT( UActorComponent*, pInitialComponent )
+    SLATE_ARGUMENT( AActor*, pOwnerActor )
     SLATE_ARGUMENT( bool, bAllowClear )
+    SLATE_ARGUMENT( bool, bAllowAnyActor )
+    SLATE_ARGUMENT( bool, bAllowUnloadedActors )
+    SLATE_ARGUMENT( bool, bMultiSelect )
+    SLATE_ARGUMENT( TArray<UActorComponent*>, oInitialComponents )
     SLATE_ARGUMENT( FOnShouldFilterActor, oActorFilter )
     SLATE_ARGUMENT( FOnShouldFilterComponent, oComponentFilter )
+    SLATE_ARGUMENT( FOnShouldFilterClass, oUnloadedActorClassFilter )
+    SLATE_ARGUMENT( FOnShouldFilterClass, oUnloadedComponentClassFilter )
+    SLATE_ARGUMENT( FComponentPickerCandidateSetPtr, pCandidateSet )
     SLATE_EVENT( FOnComponentPicked, oOnSet )
+    SLATE_EVENT( FOnComponentsPicked, oOnSetMultiple )
     SLATE_EVENT( FSimpleDelegate, oOnClose )
     SLATE_END_ARGS( )
 
     // Construct the widget.
     void Construct( const FArguments& rInArgs );
 
+    // Label of a component in the browse list.
+    static FText GetComponentLabel( const UActorComponent* pComponent, bool bAllowAnyActor );
+
+    // Search strings of a component. Game thread only, the Blueprint variable name is read from the owner class.
+    static void GetSearchEntry( const UActorComponent* pComponent,
+                                bool bAllowAnyActor,
+                                FComponentPickerSearchIndex::FEntry& rOutSearchEntry );
+
 private:
+    // An entry of the browse list.
+    struct FPickerItem
+    {
+        TWeakObjectPtr<UActorComponent> pComponent;
+        FText strLabel;
+
+        // Set for the components of World Partition actors that are not loaded
+        FGuid oUnloadedActorGuid;
+        FName strUnloadedComponentName;
+        const UClass* pUnloadedComponentClass = nullptr;
+    };
+
+    typedef TSharedPtr<FPickerItem> FPickerItemPtr;
+
+    // Add a section listing the pinned and recently picked components that pass the filters, if there is any.
+    void AddRecentSection( FMenuBuilder& rMenuBuilder );
+
+    // Build the browse list from the component index.
+    TSharedRef<SWidget> BuildBrowseList( );
+
+    // Gather the candidates from the component index and start populating the list.
+    void PopulateItems( );
+
+    // (Re)start populating the list from the first candidate, cancelling the population in progress.
+    void StartPopulation( );
+
+    // Filter candidates until the time budget is spent or enough items were added. Returns true when done.
+    bool PopulateSlice( int32 nMaxVisibleItems );
+
+    // Populates the list over several frames.
+    EActiveTimerReturnType OnPopulationTimer( double fCurrentTime, float fDeltaTime );
+
+    // Add the components of the World Partition actors that are not loaded to the candidates, walking their actor
+    // descriptors until fEndTime.
+    void AddUnloadedCandidates( double fEndTime );
+
+    // Load the actor of an item added by AddUnloadedCandidates and find its component.
+    UActorComponent* LoadUnloadedComponent( const FPickerItem& rItem );
+
+    // Build the search index from the search strings gathered by the population, on a worker thread.
+    void BuildSearchIndex( );
+    void OnSearchIndexBuilt( TSharedPtr<const FComponentPickerSearchIndex, ESPMode::ThreadSafe> pSearchIndex );
+
+    // Query the search index on a worker thread, the list is updated when the results come back.
+    void StartSearchQuery( );
+    void OnSearchQueryDone( int32 nSearchGeneration, TArray<int32>&& rCandidates );
+
+    // Does the component pass the actor and component filters.
+    bool PassesFilter( const UActorComponent* pComponent ) const;
+
+    // Is the component one of the candidates the index would list for this picker.
+    bool IsInScope( const UActorComponent* pComponent ) const;
+
+    // Browse list callbacks.
+    TSharedRef<ITableRow> OnGenerateRow( FPickerItemPtr pItem, const TSharedRef<STableViewBase>& rOwnerTable );
+    void OnSelectionChanged( FPickerItemPtr pItem, ESelectInfo::Type eSelectInfo );
+    void OnSearchTextChanged( const FText& rSearchText );
+
+    // Build the buttons shown under the browse list in multi-select mode.
+    TSharedRef<SWidget> BuildMultiSelectBar( );
+
+    // Multi-select mode: clicking an item toggles it, shift-clicking gives the range from the item clicked before
+    // the state of that item.
+    void OnItemClicked( FPickerItemPtr pItem );
+    bool IsItemChecked( const FPickerItemPtr& pItem ) const;
+    void SetItemChecked( const FPickerItemPtr& pItem, bool bChecked );
+
+    // Multi-select buttons.
+    FReply OnCheckAllMatching( );
+    FReply OnUncheckAll( );
+    FReply OnApply( );
+
     // Edit the object referenced by this widget.
     void OnEdit( );
 
+    // Pin or unpin the object referenced by this widget.
+    void OnTogglePinned( );
+
     
     // Delegate handling ctrl+c.
     void OnCopy( );
@@ -49,6 +152,10 @@ private:
     // Returns true if the current clipboard contents can be pasted.
     bool CanPaste( );
 
+    // Find the component copied to the clipboard. The text is only parsed again when it changes, and nothing is
+    // loaded: a component whose class is not loaded can't exist.
+    UActorComponent* GetClipboardComponent( );
+
     // Clear the referenced object.
     void OnClear( );
 
@@ -62,16 +169,74 @@ private:
 private:
     UActorComponent* m_pInitialComponent;
 
+    // Actor owning the edited property, used to find the candidates in the component index.
+    TWeakObjectPtr<AActor> m_pOwnerActor;
+
     // Whether the asset can be 'None' in this case.
     bool m_bAllowClear;
 
+    // Can components of other actors of the level be picked.
+    bool m_bAllowAnyActor;
+
+    // Are the World Partition actors that are not loaded listed too.
+    bool m_bAllowUnloadedActors;
+
+    // Are several components picked at once, with the checkboxes of the list.
+    bool m_bMultiSelect;
+
+    // Components checked in multi-select mode, and the item clicked last (the anchor of shift-click ranges).
+    TSet<TWeakObjectPtr<UActorComponent>> m_oCheckedComponents;
+    TWeakPtr<FPickerItem> m_pLastClickedItem;
+
+    // Components read from the index, and their list item once they passed the filters.
+    TArray<TWeakObjectPtr<UActorComponent>> m_oCandidates;
+    TArray<FPickerItemPtr> m_oCandidateItems;
+    TBitArray<> m_oEvaluatedCandidates;
+
+    // Items matching the search text.
+    TArray<FPickerItemPtr> m_oVisibleItems;
+
+    // Candidates filtered ahead of time by FComponentPickerCandidateCache, null if they are filtered here.
+    FComponentPickerCandidateSetPtr m_pCandidateSet;
+
+    // Search strings of the candidates that passed the filters, moved to the search index once all are evaluated.
+    TArray<FComponentPickerSearchIndex::FEntry> m_oSearchEntries;
+    TSharedPtr<const FComponentPickerSearchIndex, ESPMode::ThreadSafe> m_pSearchIndex;
+    bool m_bSearchIndexRequested = false;
+
+    // Incremented for every search, the results of the queries still running are dropped.
+    int32 m_nSearchGeneration = 0;
+
+    // Population progress. The unloaded actors are added by the population once the loaded candidates are evaluated.
+    TWeakPtr<FActiveTimerHandle> m_pPopulationTimer;
+    FComponentPickerUnloadedWalk m_oUnloadedWalk;
+    int32 m_nNextCandidate = 0;
+    int32 m_nPopulationFrames = 0;
+    double m_fWorstPopulationSliceTime = 0.0;
+
+    // Browse list widgets.
+    TSharedPtr<SSearchBox> m_pSearchBox;
+    TSharedPtr<SListView<FPickerItemPtr>> m_pListView;
+    FText m_strSearchText;
+
     // Delegates used to test whether a item should be displayed or not.
     FOnShouldFilterActor m_oActorFilter;
     FOnShouldFilterComponent m_oComponentFilter;
 
+    // Delegates used to pre-filter the components of unloaded actors on their class.
+    FOnShouldFilterClass m_oUnloadedActorClassFilter;
+    FOnShouldFilterClass m_oUnloadedComponentClassFilter;
+
+    // Component found in the last clipboard text, only reused while the text is the same and the component lives.
+    FString m_strClipboardText;
+    TWeakObjectPtr<UActorComponent> m_pClipboardComponent;
+
     // Delegate to call when our object value should be set.
     FOnComponentPicked m_oOnSet;
 
+    // Delegate to call with the checked components in multi-select mode.
+    FOnComponentsPicked m_oOnSetMultiple;
+
     // Delegate to call when closing the containing menu.
     FSimpleDelegate m_oOnClose;
 };